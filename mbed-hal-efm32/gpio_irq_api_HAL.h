@@ -0,0 +1,60 @@
+/***************************************************************************//**
+ * @file gpio_irq_api_HAL.h
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef MBED_GPIO_IRQ_API_HAL_H
+#define MBED_GPIO_IRQ_API_HAL_H
+
+#include <stdint.h>
+#include "mbed-hal/gpio_irq_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Purpose of this file: extend gpio_irq_api.h to include EFM-specific stuff */
+
+#if DEVICE_INTERRUPTIN
+
+typedef void (*gpio_irq_hook_t)(uint32_t id, gpio_irq_event event);
+
+/** Call a HAL-internal function on both edges of a pin
+ *
+ * Used by drivers that need to watch a pin they also hand to a peripheral,
+ * without going through gpio_irq_init(), whose handler is shared by all
+ * InterruptIn objects. A hooked pin number is no longer reported to that
+ * handler, on any port, until the hook is removed. Removing it puts the
+ * port and edge configuration of the channel back as they were.
+ *
+ * @param pin  The pin to watch
+ * @param hook The function to call, or NULL to stop watching the pin
+ * @param id   Passed to the hook
+ */
+void gpio_irq_hook(PinName pin, gpio_irq_hook_t hook, uint32_t id);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+/***************************************************************************//**
+ * @file i2c_api_HAL.h
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef MBED_I2C_API_HAL_H
+#define MBED_I2C_API_HAL_H
+
+#include <stdint.h>
+#include "mbed-hal/i2c_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Purpose of this file: extend i2c_api.h to include EFM-specific stuff */
+
+#if DEVICE_I2C_ASYNCH
+
+/* Segment flags */
+#define I2C_SEGMENT_READ        (1 << 0)    /* Read into data, otherwise write from it */
+#define I2C_SEGMENT_STOP        (1 << 1)    /* Stop after this segment, the next one starts afresh */
+#define I2C_SEGMENT_NOSTART     (1 << 2)    /* Write continuing the previous one, without (re)start and address */
+
+/** Start an asynchronous transaction made of several segments
+ *
+ * Each segment has its own direction and slave address. Consecutive segments
+ * are separated by a repeated start, unless the first one has
+ * I2C_SEGMENT_STOP, and a stop is generated after the last one. A write
+ * flagged I2C_SEGMENT_NOSTART is appended to the previous write, so
+ * scattered buffers go out as one message. The handler is called once, when
+ * the whole list is done or on the first error. Data phases go through DMA if
+ * the hint allows and a channel is free, byte by byte from the interrupt
+ * otherwise.
+ *
+ * The list is not copied and must stay valid until the transaction is over.
+ * Reads must be at least one byte long. Only 7 bit addresses are supported.
+ *
+ * @param obj      The I2C object
+ * @param segments Array of segments, in order
+ * @param count    Number of entries in segments
+ * @param handler  The I2C IRQ handler to be set
+ * @param event    The logical OR of events to be reported
+ * @param hint     DMA hint usage
+ * @return 0 on success, I2C_ERROR_BUS_BUSY if a transfer is ongoing or the slave is enabled
+ */
+int i2c_transfer_list_asynch(i2c_t *obj, const i2c_segment_t *segments, uint8_t count, uint32_t handler, uint32_t event, DMAUsage hint);
+
+/** Respond as a slave through a register file, in the background
+ *
+ * The first byte the host writes after the address selects a register. The
+ * bytes that follow are written to it, and a read, usually after a repeated
+ * start, returns its content. The selection is kept across transactions. For
+ * every data phase, regfile->access(context, reg, read, &length) returns the
+ * buffer of the register and sets the number of bytes it holds, and
+ * regfile->done(context, reg, read, length) reports how many were moved once
+ * the host is done with it. Writes beyond the buffer are NACKed, reads beyond
+ * it return 0xFF. Both callbacks run in interrupt context. access is also
+ * called when the host only selects a register, done then reports 0 bytes.
+ *
+ * While the slave is idle, sleep is not blocked: address recognition works
+ * without the peripheral clock, and an address match wakes the chip from EM2
+ * or EM3. EM1 is blocked from the address match until the stop condition.
+ * Data phases longer than a byte go through DMA if the hint allows and a
+ * channel is free, the channel is held until i2c_slave_abort_asynch().
+ * Meanwhile, as during a transfer list or a recovery, the blocking calls
+ * return I2C_ERROR_BUS_BUSY.
+ *
+ * @param obj     The I2C object
+ * @param address Slave address, in 8 bit form
+ * @param regfile Register file callbacks, must stay valid while the slave is enabled
+ * @param handler The I2C IRQ handler to be set
+ * @param event   The logical OR of events to be reported, only I2C_EVENT_ERROR is raised
+ * @param hint    DMA hint usage
+ * @return 0 on success, I2C_ERROR_BUS_BUSY if a transfer is ongoing or the slave is already enabled
+ */
+int i2c_slave_asynch(i2c_t *obj, int address, const i2c_slave_regfile_t *regfile, uint32_t handler, uint32_t event, DMAUsage hint);
+
+/** Stop responding as a slave, and return to master mode
+ *
+ * A transaction in progress is cut short. i2c_abort_asynch() does the same
+ * on an object with an enabled slave.
+ *
+ * @param obj The I2C object
+ */
+void i2c_slave_abort_asynch(i2c_t *obj);
+
+#if DEVICE_INTERRUPTIN
+
+/** Free a bus held by a slave, in the background
+ *
+ * SDA and SCL are taken over as GPIO. SCL is pulsed, up to 9 times, until
+ * the slave releases SDA, a stop condition is generated, and the peripheral
+ * is reset with its frequency and mode kept. The pulses are paced from the
+ * SCL edge interrupt, so a slave stretching the clock only slows them down.
+ * The handler is then called, and i2c_irq_handler_asynch() returns
+ * I2C_EVENT_TRANSFER_COMPLETE, or I2C_EVENT_ERROR if the bus could not be
+ * freed. A slave holding SCL can't be recovered from and fails right away.
+ *
+ * i2c_abort_asynch() starts a recovery without handler by itself when SDA
+ * is still held after aborting. i2c_abort_asynch() on a recovery in
+ * progress resets the peripheral without reporting anything.
+ *
+ * @param obj     The I2C object, without a transfer in progress
+ * @param handler The I2C IRQ handler to be called when done, or 0
+ * @param event   The logical OR of events to be reported
+ * @return 0 on success, I2C_ERROR_BUS_BUSY if a transfer, a recovery or the slave is active
+ */
+int i2c_recover_asynch(i2c_t *obj, uint32_t handler, uint32_t event);
+
+/** Get the bus recovery statistics of an I2C object
+ *
+ * @param obj   The I2C object
+ * @param stats Filled in with the counts since i2c_init()
+ */
+void i2c_recovery_stats(i2c_t *obj, i2c_recovery_stats_t *stats);
+
+#endif
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
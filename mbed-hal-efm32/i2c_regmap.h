@@ -0,0 +1,163 @@
+/***************************************************************************//**
+ * @file i2c_regmap.h
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef MBED_I2C_REGMAP_H
+#define MBED_I2C_REGMAP_H
+
+#include <stdint.h>
+#include "mbed-hal/i2c_api.h"
+#include "mbed-hal-efm32/i2c_api_HAL.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if DEVICE_I2C_ASYNCH
+
+/* Number of registers covered, from address 0. Has to be a multiple of 8. */
+#ifdef YOTTA_CFG_I2C_REGMAP_SIZE
+#define I2C_REGMAP_SIZE YOTTA_CFG_I2C_REGMAP_SIZE
+#else
+#define I2C_REGMAP_SIZE 256
+#endif
+
+#if (I2C_REGMAP_SIZE & 7) || (I2C_REGMAP_SIZE < 8) || (I2C_REGMAP_SIZE > 256)
+#error "I2C regmap size must be a multiple of 8, up to 256"
+#endif
+
+/* Runs of consecutive registers moved in one segment list */
+#define I2C_REGMAP_RUNS_MAX 4
+
+/* Returned when the device NACKed a data byte or the bus failed */
+#define I2C_REGMAP_ERROR_TRANSFER (-3)
+/* Returned when a transfer did not complete in time, it has been aborted */
+#define I2C_REGMAP_ERROR_TIMEOUT  (-4)
+
+typedef struct {
+    i2c_t *i2c;
+    uint8_t address;            /* 8 bit form */
+    uint8_t values[I2C_REGMAP_SIZE];
+    uint8_t valid[I2C_REGMAP_SIZE / 8];
+    uint8_t dirty[I2C_REGMAP_SIZE / 8];
+    uint8_t uncached[I2C_REGMAP_SIZE / 8];
+    /* Register bytes and segments of the transfer in flight */
+    uint8_t regs[I2C_REGMAP_RUNS_MAX];
+    i2c_segment_t segments[2 * I2C_REGMAP_RUNS_MAX];
+    volatile uint32_t busy;
+    volatile uint32_t event;
+    /* Statistics, may be reset by the application */
+    uint32_t hits;              /* Registers read from the cache */
+    uint32_t misses;            /* Registers read from the device */
+    uint32_t bytes_saved;       /* Bus bytes saved over one transaction per register access */
+} i2c_regmap_t;
+
+/** Set up a register cache for a device
+ *
+ * Registers are 8 bits wide, with 8 bit addresses that auto-increment over
+ * bursts. All registers start out as uncached non-volatile ones.
+ *
+ * Transfers go through i2c_transfer_list_asynch(), and the calls below block,
+ * sleeping, until they are done. Caches for several devices, on the same bus
+ * or not, may be used from thread context, but not from interrupts.
+ *
+ * @param map     The cache
+ * @param i2c     The I2C object the device is connected to, initialized
+ * @param address Slave address of the device, in 8 bit form
+ */
+void i2c_regmap_init(i2c_regmap_t *map, i2c_t *i2c, uint8_t address);
+
+/** Mark registers as volatile
+ *
+ * Volatile registers, such as status or FIFO registers, are always read from
+ * the device, and written to it right away.
+ *
+ * @param map   The cache
+ * @param reg   First register of the range
+ * @param count Number of registers
+ */
+void i2c_regmap_set_volatile(i2c_regmap_t *map, uint8_t reg, uint16_t count);
+
+/** Read consecutive registers
+ *
+ * Cached registers are taken from RAM. The others are read in bursts, one for
+ * each run of consecutive uncached registers, and cached unless volatile.
+ *
+ * @param map    The cache
+ * @param reg    First register to read
+ * @param buffer Where to store the values
+ * @param length Number of registers
+ * @return 0 on success, I2C_ERROR_NO_SLAVE, I2C_ERROR_BUS_BUSY,
+ *         I2C_REGMAP_ERROR_TRANSFER or I2C_REGMAP_ERROR_TIMEOUT
+ */
+int i2c_regmap_read(i2c_regmap_t *map, uint8_t reg, uint8_t *buffer, uint16_t length);
+
+/** Write consecutive registers
+ *
+ * Values of non-volatile registers are only stored in the cache and written
+ * to the device by i2c_regmap_sync(), together with the other pending
+ * writes, in one burst for each run of consecutive registers. If the range
+ * contains volatile registers, it is written right away, along with the
+ * non-volatile registers pending in it.
+ *
+ * @param map    The cache
+ * @param reg    First register to write
+ * @param buffer The values
+ * @param length Number of registers
+ * @return 0 on success, or an error as for i2c_regmap_read()
+ */
+int i2c_regmap_write(i2c_regmap_t *map, uint8_t reg, const uint8_t *buffer, uint16_t length);
+
+/** Change some bits of a register
+ *
+ * The register is read from the cache when possible, and only written if
+ * its value changes or it is volatile.
+ *
+ * @param map   The cache
+ * @param reg   The register
+ * @param mask  Bits to change
+ * @param value New value of these bits
+ * @return 0 on success, or an error as for i2c_regmap_read()
+ */
+int i2c_regmap_update_bits(i2c_regmap_t *map, uint8_t reg, uint8_t mask, uint8_t value);
+
+/** Write all pending register values to the device
+ *
+ * @param map The cache
+ * @return 0 on success, or an error as for i2c_regmap_read(). Registers not
+ *         written stay pending.
+ */
+int i2c_regmap_sync(i2c_regmap_t *map);
+
+/** Drop all cached values, including pending writes, e.g. after a device reset
+ *
+ * @param map The cache
+ */
+void i2c_regmap_invalidate(i2c_regmap_t *map);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
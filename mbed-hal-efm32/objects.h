@@ -61,11 +61,67 @@ struct dac_s {
 #endif
 
 #if DEVICE_I2C
+#if DEVICE_I2C_ASYNCH
+/* One part of a multi-segment transaction, see i2c_transfer_list_asynch() */
+typedef struct {
+    uint8_t *data;
+    uint16_t length;
+    uint8_t address;            /* 8 bit form, the R/W bit is ignored */
+    uint8_t flags;              /* I2C_SEGMENT_xxx */
+} i2c_segment_t;
+
+/* Register file behind an asynchronous slave, see i2c_slave_asynch() */
+typedef struct {
+    uint8_t *(*access)(void *context, uint8_t reg, uint8_t read, uint16_t *length);
+    void (*done)(void *context, uint8_t reg, uint8_t read, uint16_t length);
+    void *context;
+} i2c_slave_regfile_t;
+
+/* Bus recovery statistics, see i2c_recovery_stats() */
+typedef struct {
+    uint32_t recoveries;        /* Recoveries started */
+    uint32_t failures;          /* Recoveries after which the bus was still held */
+    uint32_t pulses;            /* SCL pulses generated, over all recoveries */
+} i2c_recovery_stats_t;
+#endif
+
 struct i2c_s {
     I2C_TypeDef *i2c;
+    PinName sda;
+    PinName scl;
 #if DEVICE_I2C_ASYNCH
     uint32_t events;
     I2C_TransferSeq_TypeDef xfer;
+    /* Transfers run by the HAL. Data phases go through DMA when a channel is held, the rest in the I2C interrupt. */
+    const i2c_segment_t *segments;
+    i2c_segment_t segments_local[2]; /* Backs i2c_transfer_asynch() */
+    uint8_t seg_count;
+    uint8_t seg_index;          /* Segment in progress */
+    uint16_t seg_offset;        /* Bytes of it moved by the interrupt */
+    uint8_t phase;              /* 0 when emlib drives the transfer */
+    uint8_t use_dma;            /* Current data phase is on DMA */
+    /* Asynchronous slave. Data phases use seg_offset, use_dma and phase as well. */
+    const i2c_slave_regfile_t *regfile;
+    uint8_t *slave_data;        /* Buffer of the data phase in progress */
+    uint16_t slave_length;
+    uint8_t slave;              /* Non-zero while the slave is enabled */
+    uint8_t slave_reg;          /* Register selected by the host */
+    uint8_t slave_fill;         /* The buffer has run out, fill bytes are being sent */
+    /* Bus recovery */
+    uint32_t recover_handler;
+    uint32_t recover_event;     /* Outcome, picked up by i2c_irq_handler_asynch() */
+    uint8_t recover_step;       /* Pulses in the recovery in progress */
+    uint8_t recover_stop;       /* SDA is free, the next pulse is a stop condition */
+    uint32_t recover_count;
+    uint32_t recover_failed;
+    uint32_t recover_pulses;
+    DMA_OPTIONS_t dmaOptions;
+#ifdef LDMA_PRESENT
+    uint32_t dma_ctrl;          /* CTRL without AUTOACK, written by DMA before the last byte of a read */
+    LDMA_Descriptor_t dma_desc[2];
+#else
+    DMA_DESCRIPTOR_TypeDef dma_desc[1];
+#endif
 #endif
 };
 #endif
@@ -95,6 +151,54 @@ struct gpio_irq_s {
 #endif
 
 #if DEVICE_SERIAL
+#if DEVICE_SERIAL_ASYNCH
+/* Maximum number of segments in one scatter-gather TX request,
+ * 0 leaves out serial_tx_segments_asynch() */
+#ifdef YOTTA_CFG_SERIAL_TX_SEGMENTS_MAX
+#define SERIAL_TX_SEGMENTS_MAX  YOTTA_CFG_SERIAL_TX_SEGMENTS_MAX
+#else
+#define SERIAL_TX_SEGMENTS_MAX  4
+#endif
+/* Number of TX requests that can wait behind the one being transmitted,
+ * 0 to refuse requests until it is done */
+#ifdef YOTTA_CFG_SERIAL_TX_QUEUE_SIZE
+#define SERIAL_TX_QUEUE_SIZE    YOTTA_CFG_SERIAL_TX_QUEUE_SIZE
+#elif SERIAL_TX_SEGMENTS_MAX > 0
+#define SERIAL_TX_QUEUE_SIZE    4
+#else
+#define SERIAL_TX_QUEUE_SIZE    0
+#endif
+/* Maximum number of buffers handed to zero-copy reception,
+ * 0 leaves out serial_rx_pool_asynch() */
+#ifdef YOTTA_CFG_SERIAL_RX_POOL_MAX
+#define SERIAL_RX_POOL_MAX      YOTTA_CFG_SERIAL_RX_POOL_MAX
+#else
+#define SERIAL_RX_POOL_MAX      8
+#endif
+
+#if (SERIAL_TX_QUEUE_SIZE > 0) && (SERIAL_TX_SEGMENTS_MAX == 0)
+#error "The serial TX queue holds scatter-gather requests, it needs SERIAL_TX_SEGMENTS_MAX"
+#endif
+#if (SERIAL_TX_SEGMENTS_MAX > 255) || (SERIAL_TX_QUEUE_SIZE > 255)
+#error "Serial TX segments and queue entries are counted in 8 bits"
+#endif
+#if (SERIAL_RX_POOL_MAX > 0) && ((SERIAL_RX_POOL_MAX < 3) || (SERIAL_RX_POOL_MAX > 255))
+#error "A serial RX pool takes 3 to 255 buffers"
+#endif
+
+typedef struct {
+    const void *buffer;
+    uint16_t length;
+} serial_tx_segment_t;
+
+#if SERIAL_TX_QUEUE_SIZE > 0
+typedef struct {
+    serial_tx_segment_t segments[SERIAL_TX_SEGMENTS_MAX];
+    uint8_t count;
+} serial_tx_request_t;
+#endif
+#endif
+
 struct serial_s {
     union {
         USART_TypeDef *uart;
@@ -108,26 +212,144 @@ struct serial_s {
 #endif
     PinName rx_pin;
     PinName tx_pin;
+#if DEVICE_SERIAL_FC
+    PinName rts_pin;
+    PinName cts_pin;
+#endif
 #if DEVICE_SERIAL_ASYNCH
     uint32_t events;
     DMA_OPTIONS_t dmaOptionsTX;
     DMA_OPTIONS_t dmaOptionsRX;
+    /* Continuous (circular) DMA reception */
+    uint8_t *rx_circ_buffer[2];
+    uint16_t rx_circ_length[2];
+    uint32_t rx_circ_events;
+    uint32_t rx_circ_handler;
+    uint8_t rx_circ_active;
+    uint8_t rx_circ_slot;
+#ifdef LDMA_PRESENT
+    LDMA_Descriptor_t rx_circ_desc[2];
+#endif
+    /* Zero-copy buffer hand-off on top of continuous reception */
+    uint8_t rx_pool_active;
+#if SERIAL_RX_POOL_MAX > 0
+    uint8_t *rx_pool_free[SERIAL_RX_POOL_MAX];
+    uint8_t *rx_pool_full[SERIAL_RX_POOL_MAX];
+    uint8_t rx_pool_free_head;
+    uint8_t rx_pool_free_count;
+    uint8_t rx_pool_full_head;
+    uint8_t rx_pool_full_count;
+#endif
+#if SERIAL_TX_SEGMENTS_MAX > 0
+    /* Queued scatter-gather transmission */
+    uint8_t tx_queue_active;
+#if SERIAL_TX_QUEUE_SIZE > 0
+    uint8_t tx_queue_head;
+    uint8_t tx_queue_count;
+    uint8_t tx_queue_done;
+    uint32_t tx_queue_handler;
+    serial_tx_request_t tx_queue[SERIAL_TX_QUEUE_SIZE];
+#endif
+#ifdef LDMA_PRESENT
+    LDMA_Descriptor_t tx_sg_desc[SERIAL_TX_SEGMENTS_MAX];
+#else
+    DMA_DESCRIPTOR_TypeDef tx_sg_desc[SERIAL_TX_SEGMENTS_MAX];
+#endif
+#endif
 #endif
     uint32_t sleep_blocked;
 };
 #endif
 
 #if DEVICE_SPI
+#if DEVICE_SPI_ASYNCH
+/* Number of chained DMA descriptors per direction. Transfers longer than
+ * what fits in one list are continued from the DMA interrupt. */
+#ifdef YOTTA_CFG_SPI_DMA_DESCRIPTORS_MAX
+#define SPI_DMA_DESCRIPTORS_MAX YOTTA_CFG_SPI_DMA_DESCRIPTORS_MAX
+#else
+#define SPI_DMA_DESCRIPTORS_MAX 8
+#endif
+/* Number of transactions that can wait behind the one in progress,
+ * 0 to refuse transactions while the bus is busy */
+#ifdef YOTTA_CFG_SPI_TRANSACTION_QUEUE_SIZE
+#define SPI_TRANSACTION_QUEUE_SIZE YOTTA_CFG_SPI_TRANSACTION_QUEUE_SIZE
+#else
+#define SPI_TRANSACTION_QUEUE_SIZE 4
+#endif
+
+/* All DMA transfers go through the lists, and one descriptor is kept spare */
+#if SPI_DMA_DESCRIPTORS_MAX < 2
+#error "SPI DMA needs at least 2 descriptors per direction"
+#endif
+#if SPI_TRANSACTION_QUEUE_SIZE > 255
+#error "SPI queue entries are counted in 8 bits"
+#endif
+
+typedef struct {
+    PinName cs;         /* Driven low for the duration of a transaction, NC if unused */
+    int frequency;
+    uint8_t bits;
+    uint8_t mode;
+    uint8_t order;      /* spi_bitorder_t */
+    /* Register images, filled in by spi_device_prepare(). FRAME is 0 if not prepared. */
+    uint32_t ctrl;
+    uint32_t frame;
+    uint32_t clkdiv;
+} spi_device_t;
+
+typedef struct {
+    const spi_device_t *device;
+    const void *tx;
+    void *rx;
+    uint32_t tx_length;
+    uint32_t rx_length;
+    uint32_t handler;
+    uint32_t event;
+    DMAUsage hint;
+} spi_transaction_t;
+#endif
+
 struct spi_s {
     USART_TypeDef *spi;
     int location;
     uint8_t bits;
     uint8_t master;
     uint8_t msbf;
+    /* Chip select driven by the USART (AUTOCS), NC if left to software */
+    PinName cs_pin;
+    uint8_t cs_setup;
+    uint8_t cs_hold;
 #if DEVICE_SPI_ASYNCH
     uint32_t event;
     DMA_OPTIONS_t dmaOptionsTX;
     DMA_OPTIONS_t dmaOptionsRX;
+#ifdef LDMA_PRESENT
+    LDMA_Descriptor_t dma_tx_desc[SPI_DMA_DESCRIPTORS_MAX];
+    LDMA_Descriptor_t dma_rx_desc[SPI_DMA_DESCRIPTORS_MAX];
+#else
+    DMA_DESCRIPTOR_TypeDef dma_tx_desc[SPI_DMA_DESCRIPTORS_MAX];
+    DMA_DESCRIPTOR_TypeDef dma_rx_desc[SPI_DMA_DESCRIPTORS_MAX];
+#endif
+    /* Transaction queue */
+    const spi_device_t *queue_device;
+    uint8_t queue_active;
+#if SPI_TRANSACTION_QUEUE_SIZE > 0
+    uint8_t queue_head;
+    uint8_t queue_count;
+    spi_transaction_t queue[SPI_TRANSACTION_QUEUE_SIZE];
+#endif
+    /* Slave transfers, and the buffers staged to follow the armed one */
+    uint32_t slave_handler;
+    uint32_t slave_received;
+    const void *slave_next_tx;
+    void *slave_next_rx;
+    uint32_t slave_next_tx_length;
+    uint32_t slave_next_rx_length;
+    uint8_t slave_next_valid;
+    uint8_t slave_active;
+    uint8_t slave_selected;
+    uint8_t slave_deselected;
 #endif
 };
 #endif
@@ -0,0 +1,150 @@
+/***************************************************************************//**
+ * @file serial_api_HAL.h
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef MBED_SERIAL_API_HAL_H
+#define MBED_SERIAL_API_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mbed-hal/serial_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Purpose of this file: extend serial_api.h to include EFM-specific stuff */
+
+#if DEVICE_SERIAL_ASYNCH
+
+/* Events raised by continuous reception. These sit above SERIAL_EVENT_RX_ALL,
+ * so they are only seen by callers that inspect the return value of
+ * serial_irq_handler_asynch() themselves. */
+#define SERIAL_EVENT_RX_HALF     (1 << (SERIAL_EVENT_RX_SHIFT + 6))
+#define SERIAL_EVENT_RX_WRAP     (1 << (SERIAL_EVENT_RX_SHIFT + 7))
+#define SERIAL_EVENT_RX_IDLE     (1 << (SERIAL_EVENT_RX_SHIFT + 8))
+#define SERIAL_EVENT_RX_BUFFER   (1 << (SERIAL_EVENT_RX_SHIFT + 9))
+#define SERIAL_EVENT_RX_POOL_EMPTY (1 << (SERIAL_EVENT_RX_SHIFT + 10))
+
+/* Returned when a TX request can neither be started nor queued */
+#define SERIAL_ERROR_TX_BUSY     (-2)
+
+/* Returned when idle detection is asked of a peripheral that can't do it */
+#define SERIAL_ERROR_NO_IDLE     (-3)
+
+/** Start continuous reception into a circular buffer
+ *
+ * DMA keeps running until serial_rx_abort_asynch() is called. The handler is
+ * invoked when the first half of the buffer has been filled (RX_HALF), when the
+ * end of the buffer has been reached and reception wrapped (RX_WRAP), and, on
+ * USARTs with TIMECMP, when the line has been idle for idle_bits bit periods
+ * after a frame (RX_IDLE). LEUARTs and USARTs without TIMECMP refuse to start
+ * if RX_IDLE is requested or idle_bits is not 0. RX_IDLE with idle_bits 0 is
+ * refused as well, it could never be raised.
+ *
+ * @param obj       The serial object
+ * @param rx        The circular receive buffer
+ * @param rx_length Size of the buffer, in bytes
+ * @param handler   The function to call when an event occurs
+ * @param event     The logical OR of events to be reported
+ * @param idle_bits Idle timeout in bit periods, 0 to disable idle detection
+ * @return 0 on success, DMA_ERROR_OUT_OF_CHANNELS if no DMA channel was available,
+ *         SERIAL_ERROR_NO_IDLE if idle detection is not supported, or RX_IDLE
+ *         was requested with idle_bits 0
+ */
+int serial_rx_circular_asynch(serial_t *obj, void *rx, size_t rx_length, uint32_t handler, uint32_t event, uint8_t idle_bits);
+
+/** Get the write index of an ongoing continuous reception
+ *
+ * @param obj The serial object
+ * @return Offset in the circular buffer where the next byte will be stored
+ */
+size_t serial_rx_circular_index(serial_t *obj);
+
+#if SERIAL_RX_POOL_MAX > 0
+/** Start zero-copy reception into a pool of buffers
+ *
+ * DMA ping-pongs between two buffers of the pool. Each time one is full, it is
+ * handed over to the application (SERIAL_EVENT_RX_BUFFER) and replaced by a
+ * free one while reception continues. Filled buffers are fetched with
+ * serial_rx_pool_get() and given back with serial_rx_pool_release(). If the
+ * application holds on to all spare buffers, the filled one is reused and
+ * SERIAL_EVENT_RX_POOL_EMPTY is reported instead. Unlike
+ * SERIAL_EVENT_RX_OVERFLOW, the peripheral has not lost anything, but the
+ * data in that buffer is overwritten. Runs until
+ * serial_rx_abort_asynch() is called.
+ *
+ * @param obj     The serial object
+ * @param buffers Array of buffers, all of the same size
+ * @param count   Number of buffers, at least 3 and at most SERIAL_RX_POOL_MAX
+ * @param length  Size of each buffer, in bytes
+ * @param handler The function to call when an event occurs
+ * @param event   The logical OR of events to be reported
+ * @return 0 on success, DMA_ERROR_OUT_OF_CHANNELS if no DMA channel was available
+ */
+int serial_rx_pool_asynch(serial_t *obj, void * const *buffers, uint8_t count, size_t length, uint32_t handler, uint32_t event);
+
+/** Take ownership of the oldest filled buffer
+ *
+ * @param obj The serial object
+ * @return The buffer, or NULL if none has been filled
+ */
+void *serial_rx_pool_get(serial_t *obj);
+
+/** Give a buffer obtained from serial_rx_pool_get() back to the driver
+ *
+ * @param obj    The serial object
+ * @param buffer The buffer
+ */
+void serial_rx_pool_release(serial_t *obj, void *buffer);
+#endif
+
+#if SERIAL_TX_SEGMENTS_MAX > 0
+/** Transmit a list of buffers back-to-back, or queue them behind an ongoing
+ *  scatter-gather transmission
+ *
+ * The segments are chained in DMA descriptors, so they go out without copying
+ * and without idle time between them. A request issued while another one is
+ * being transmitted is appended to a queue of SERIAL_TX_QUEUE_SIZE entries and
+ * started from the DMA interrupt as soon as the previous one has been handed to
+ * the peripheral. With a queue size of 0 it is refused instead.
+ * SERIAL_EVENT_TX_COMPLETE is reported once per request. The segment array is
+ * copied, the buffers it points to are not.
+ *
+ * @param obj      The serial object
+ * @param segments Array of buffers to send, in order
+ * @param count    Number of entries in segments, at most SERIAL_TX_SEGMENTS_MAX
+ * @param handler  The function to call when an event occurs (used when starting)
+ * @param event    The logical OR of events to be reported (used when starting)
+ * @return 0 on success, DMA_ERROR_OUT_OF_CHANNELS if no DMA channel was available,
+ *         SERIAL_ERROR_TX_BUSY if the queue is full or a plain TX transfer is ongoing
+ */
+int serial_tx_segments_asynch(serial_t *obj, const serial_tx_segment_t *segments, uint8_t count, uint32_t handler, uint32_t event);
+#endif
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -44,6 +44,17 @@ void blockSleepMode(sleepstate_enum minimumMode);
 */
 void unblockSleepMode(sleepstate_enum minimumMode);
 
+/*
+* Sleeps as long as (*flag & mask) == value, or until timeout_us has passed
+*
+* @param flag       Word changed from an interrupt, or a peripheral register
+* @param mask       Bits of the flag to look at
+* @param value      The value to wait to change
+* @param timeout_us Timeout in microseconds, 0 to wait forever
+* @return (*flag & mask) on return, still value on a timeout
+*/
+uint32_t sleep_while(volatile const uint32_t *flag, uint32_t mask, uint32_t value, uint32_t timeout_us);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,193 @@
+/***************************************************************************//**
+ * @file spi_api_HAL.h
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef MBED_SPI_API_HAL_H
+#define MBED_SPI_API_HAL_H
+
+#include <stdint.h>
+#include "mbed-hal/spi_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Purpose of this file: extend spi_api.h to include EFM-specific stuff */
+
+#if DEVICE_SPI
+
+/** Let the USART drive a chip select pin (AUTOCS)
+ *
+ * The pin is asserted when a frame is written to an idle transmitter and
+ * released once the transmitter runs empty, so it follows a DMA transfer
+ * without software involvement. Transfers with gaps between frames (such as
+ * blocking spi_master_write() calls) release it between frames.
+ *
+ * On devices with a USART TIMING register, setup and hold are inserted between
+ * chip select and the first and last clock edge. Supported values are 0 to 3
+ * bit periods, larger values are rounded up to 7. Elsewhere they are ignored.
+ *
+ * @param obj   The SPI object
+ * @param cs    Pin routable to the CS function of this USART, or NC to release
+ *              the previous pin back to software (driven high)
+ * @param setup Chip select setup time, in bit periods
+ * @param hold  Chip select hold time, in bit periods
+ */
+void spi_auto_cs(spi_t *obj, PinName cs, uint8_t setup, uint8_t hold);
+
+/** Initialize the SPI peripheral as a slave
+ *
+ * Frames are clocked by the master, so the frequency set with spi_frequency()
+ * has no effect. spi_format() keeps the peripheral in slave mode. The chip
+ * select pin is handed to the USART, which ignores the bus while it is high.
+ *
+ * @param obj  The SPI object to initialize
+ * @param mosi The pin to use for MOSI (input)
+ * @param miso The pin to use for MISO (output), or NC
+ * @param clk  The pin to use for SCLK (input)
+ * @param cs   Pin routable to the CS function of this USART
+ */
+void spi_slave_init(spi_t *obj, PinName mosi, PinName miso, PinName clk, PinName cs);
+
+/** Write a block of frames out in master mode, and receive at the same time
+ *
+ * Blocking, without DMA. The TX buffer is refilled as soon as it runs empty
+ * and RX is drained in the same loop, so frames go out back-to-back instead
+ * of one round trip per frame as with spi_master_write(). Frames of 8 bits
+ * or less are moved two at a time through TXDOUBLE and RXDOUBLE. Meant for
+ * short transfers where setting up DMA costs more than it saves.
+ *
+ * Buffers hold one byte per frame for frames of up to 8 bits, and one
+ * uint16_t per frame otherwise. After tx_length frames the fill word is sent.
+ *
+ * @param obj       The SPI object, not busy with an asynchronous transfer
+ * @param tx        The buffer to send, or NULL to send the fill word only
+ * @param tx_length The number of frames to send
+ * @param rx        The buffer to receive into, or NULL
+ * @param rx_length The number of frames to receive
+ * @return Number of frames clocked, max(tx_length, rx_length)
+ */
+int spi_master_block_write(spi_t *obj, const void *tx, int tx_length, void *rx, int rx_length);
+
+#endif
+
+#if DEVICE_SPI_ASYNCH
+
+/* Returned when a transaction can not be queued */
+#define SPI_ERROR_QUEUE_FULL     (-2)
+/* Returned when slave buffers can not be armed or staged */
+#define SPI_ERROR_SLAVE_BUSY     (-3)
+
+/* Raised together with SPI_EVENT_COMPLETE when the master deselected the slave
+ * before the lengths given were reached. This sits above SPI_EVENT_ALL, so it
+ * is only seen by callers that inspect the return value of
+ * spi_irq_handler_asynch() themselves. */
+#define SPI_EVENT_SLAVE_DESELECT (1 << 4)
+
+/** Precompute the register settings of a device for spi_master_transfer_queue()
+ *
+ * Call after filling in frequency, bits, mode and order, and again whenever
+ * one of them changes. A prepared device is switched to in a few register
+ * writes, rather than through spi_format() and spi_frequency(). Devices that
+ * have not been prepared still work, at the cost of the full reconfiguration.
+ *
+ * @param device The device to prepare
+ */
+void spi_device_prepare(spi_device_t *device);
+
+/** Queue an SPI master transaction
+ *
+ * The transaction is started right away if the bus is idle. Otherwise it waits
+ * in a queue of SPI_TRANSACTION_QUEUE_SIZE entries and is started from the
+ * completion interrupt of the previous transfer, without a round trip through
+ * thread context. With a queue size of 0 it is refused instead. When the device differs from the one of the previous
+ * transaction, the bus is reconfigured to its format and frequency first (see
+ * spi_device_prepare()). The
+ * chip select pin of the device is driven low for the duration of the transfer,
+ * unless it is the pin handed to the USART with spi_auto_cs().
+ *
+ * The transaction is copied; the device and the buffers are not and must stay
+ * valid until the transaction has completed. The handler is called as for
+ * spi_master_transfer(). spi_abort_asynch() also drops all queued transactions.
+ *
+ * @param obj         The SPI object
+ * @param transaction The transaction to queue
+ * @return 0 on success, SPI_ERROR_QUEUE_FULL if the queue is full, or the bus
+ *         is busy and there is no queue
+ */
+int spi_master_transfer_queue(spi_t *obj, const spi_transaction_t *transaction);
+
+/** Arm a slave transfer
+ *
+ * Both DMA lists are set up right away, so the first frames of tx are loaded
+ * into the USART before the master starts clocking. Once tx_length frames
+ * have been sent the fill word follows. The transfer completes when
+ * max(tx_length, rx_length) frames have been clocked, or, on devices with
+ * InterruptIn support, when the master deasserts chip select earlier. The
+ * handler is called as for spi_master_transfer(). Slave transfers always use
+ * DMA, with channels held as for DMA_USAGE_OPPORTUNISTIC unless they were
+ * allocated earlier.
+ *
+ * @param obj       The SPI object, initialized with spi_slave_init()
+ * @param tx        The buffer to send, or NULL to send the fill word only
+ * @param tx_length The number of frames to send
+ * @param rx        The buffer to receive into, or NULL
+ * @param rx_length The number of frames to receive
+ * @param handler   SPI interrupt handler
+ * @param event     The logical OR of events to be reported
+ * @return 0 on success, SPI_ERROR_SLAVE_BUSY if a transfer is armed,
+ *         DMA_ERROR_OUT_OF_CHANNELS if no DMA channel was available
+ */
+int spi_slave_transfer(spi_t *obj, const void *tx, uint32_t tx_length, void *rx, uint32_t rx_length, uint32_t handler, uint32_t event);
+
+/** Stage the buffers for the slave transfer following the armed one
+ *
+ * The staged buffers are armed from the completion interrupt of the current
+ * transfer, so a response prepared while the master is still talking is in
+ * place for its next transaction without a round trip through thread context.
+ * If no transfer is armed, they are armed right away with the handler and
+ * events of the previous spi_slave_transfer().
+ *
+ * @param obj       The SPI object
+ * @param tx        The buffer to send, or NULL
+ * @param tx_length The number of frames to send
+ * @param rx        The buffer to receive into, or NULL
+ * @param rx_length The number of frames to receive
+ * @return 0 on success, SPI_ERROR_SLAVE_BUSY if buffers are already staged,
+ *         DMA_ERROR_OUT_OF_CHANNELS if no DMA channel was available
+ */
+int spi_slave_transfer_next(spi_t *obj, const void *tx, uint32_t tx_length, void *rx, uint32_t rx_length);
+
+/** Get the amount of frames received by the last completed slave transfer
+ *
+ * @param obj The SPI object
+ * @return Number of frames stored in the receive buffer
+ */
+uint32_t spi_slave_received(spi_t *obj);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
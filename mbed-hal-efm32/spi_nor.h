@@ -0,0 +1,123 @@
+/***************************************************************************//**
+ * @file spi_nor.h
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef MBED_SPI_NOR_H
+#define MBED_SPI_NOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mbed-hal/spi_api.h"
+#include "mbed-hal-efm32/spi_api_HAL.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if DEVICE_SPI_ASYNCH
+
+/* Cache geometry. The line size has to be a power of two. */
+#ifdef YOTTA_CFG_SPI_NOR_CACHE_LINE_SIZE
+#define SPI_NOR_CACHE_LINE_SIZE YOTTA_CFG_SPI_NOR_CACHE_LINE_SIZE
+#else
+#define SPI_NOR_CACHE_LINE_SIZE 256
+#endif
+#ifdef YOTTA_CFG_SPI_NOR_CACHE_LINES
+#define SPI_NOR_CACHE_LINES YOTTA_CFG_SPI_NOR_CACHE_LINES
+#else
+#define SPI_NOR_CACHE_LINES 4
+#endif
+
+#if (SPI_NOR_CACHE_LINE_SIZE & (SPI_NOR_CACHE_LINE_SIZE - 1)) || (SPI_NOR_CACHE_LINES < 1)
+#error "SPI NOR cache line size must be a power of two, with at least one line"
+#endif
+
+/* Fast read (0x0B): opcode, 24 bit address and one dummy byte */
+#define SPI_NOR_READ_HEADER 5
+
+/* Returned when a line could not be read in time, the SPI transfers have been aborted */
+#define SPI_NOR_ERROR_TIMEOUT (-4)
+
+typedef struct {
+    uint32_t addr;              /* Flash address of the first byte */
+    uint32_t stamp;             /* Last use, for replacement */
+    volatile uint32_t state;
+    /* Data follows the bytes clocked in while the header went out */
+    uint8_t raw[SPI_NOR_READ_HEADER + SPI_NOR_CACHE_LINE_SIZE];
+} spi_nor_line_t;
+
+typedef struct {
+    spi_t *spi;
+    spi_device_t device;
+    spi_nor_line_t lines[SPI_NOR_CACHE_LINES];
+    uint8_t cmd[SPI_NOR_READ_HEADER];
+    volatile int8_t filling;    /* Line being read from flash, -1 if none */
+    uint32_t stamp;
+    /* Statistics, may be reset by the application */
+    uint32_t hits;              /* Reads served from a cached or prefetched line */
+    uint32_t misses;            /* Reads that had to wait for flash */
+    uint32_t prefetches;        /* Lines read ahead */
+} spi_nor_t;
+
+/** Set up a read cache in front of an SPI NOR flash
+ *
+ * Reads go through the transaction queue of the SPI object (see
+ * spi_master_transfer_queue()), so the bus may be shared with other devices.
+ * Only one cache can be active at a time.
+ *
+ * @param nor       The cache
+ * @param spi       The SPI object the flash is connected to, initialized as master
+ * @param cs        Chip select of the flash
+ * @param frequency Bus frequency for the flash
+ */
+void spi_nor_init(spi_nor_t *nor, spi_t *spi, PinName cs, int frequency);
+
+/** Read from flash through the cache
+ *
+ * Blocks, sleeping while waiting for flash. Each line read from flash is
+ * followed by a read of the next line in the background, so sequential reads
+ * find their data in RAM. A line that has not arrived after 100 ms is given
+ * up on: the transfers of the SPI object, including those queued for other
+ * devices, are aborted.
+ *
+ * @param nor    The cache
+ * @param addr   Flash address to read from
+ * @param buffer Where to store the data
+ * @param length Number of bytes to read
+ * @return 0 on success, SPI_ERROR_QUEUE_FULL if the read could not be queued,
+ *         or SPI_NOR_ERROR_TIMEOUT if flash did not answer in time
+ */
+int spi_nor_read(spi_nor_t *nor, uint32_t addr, void *buffer, size_t length);
+
+/** Drop all cached data, e.g. after the flash has been written or erased
+ *
+ * @param nor The cache
+ */
+void spi_nor_invalidate(spi_nor_t *nor);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+/***************************************************************************//**
+ * @file usart_baud.h
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#ifndef MBED_USART_BAUD_H
+#define MBED_USART_BAUD_H
+
+#include <stdint.h>
+#include "em_usart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Find the oversampling and fractional clock divider giving the asynchronous
+ * baud rate closest to the requested one. All of OVS 16/8/6/4 are tried, and
+ * on equal error the highest oversampling wins.
+ * @param refFreq  USART reference clock, 0 to use the current HFPERCLK
+ * @param baudrate Requested baud rate
+ * @param ovs      Returns the oversampling setting to use
+ * @param clkdiv   Returns the value for the CLKDIV register
+ * @return The baud rate actually achieved, or 0 if the rate can't be reached
+ */
+uint32_t usart_baud_async_solve(uint32_t refFreq, uint32_t baudrate, USART_OVS_TypeDef *ovs, uint32_t *clkdiv);
+
+/**
+ * Solve for and apply an asynchronous baud rate
+ * @param usart    The USART to configure
+ * @param refFreq  USART reference clock, 0 to use the current HFPERCLK
+ * @param baudrate Requested baud rate
+ * @return The baud rate actually achieved
+ */
+uint32_t usart_baud_async_set(USART_TypeDef *usart, uint32_t refFreq, uint32_t baudrate);
+
+/**
+ * Find the highest synchronous (SPI) bit rate not exceeding the requested one
+ * @param refFreq USART reference clock, 0 to use the current HFPERCLK
+ * @param hz      Requested bit rate
+ * @param clkdiv  Returns the value for the CLKDIV register
+ * @return The bit rate actually achieved
+ */
+uint32_t usart_baud_sync_solve(uint32_t refFreq, uint32_t hz, uint32_t *clkdiv);
+
+/**
+ * Apply the highest synchronous (SPI) bit rate not exceeding the requested one
+ * @param usart   The USART to configure
+ * @param refFreq USART reference clock, 0 to use the current HFPERCLK
+ * @param hz      Requested bit rate
+ * @return The bit rate actually achieved
+ */
+uint32_t usart_baud_sync_set(USART_TypeDef *usart, uint32_t refFreq, uint32_t hz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -31,6 +31,7 @@
 #include "mbed-hal/sleep_api.h"
 
 #include "mbed-hal-efm32/sleepmodes.h"
+#include "mbed-hal-efm32/gpio_irq_api_HAL.h"
 
 #include "em_gpio.h"
 #include "em_int.h"
@@ -39,6 +40,12 @@
 #include "uvisor-lib/uvisor-lib.h"
 
 #define NUM_GPIO_CHANNELS (16)
+
+/* Layout of channel_hook_saved entries */
+#define HOOK_SAVED_PORT_MASK    (0x0F)
+#define HOOK_SAVED_RISE         (0x10)
+#define HOOK_SAVED_FALL         (0x20)
+#define HOOK_SAVED_ENABLE       (0x40)
 #define GPIO_LEAST_ACTIVE_SLEEPMODE EM3
 
 /* Macro return index of the LSB flag which is set. */
@@ -58,13 +65,16 @@ __STATIC_INLINE uint32_t countTrailingZeros(uint32_t mask)
 
 static uint32_t channel_ids[NUM_GPIO_CHANNELS] = { 0 }; // Relates pin number with interrupt action id
 static uint8_t channel_ports[NUM_GPIO_CHANNELS/2] = { 0 }; // Storing 2 ports in each uint8
+static gpio_irq_hook_t channel_hooks[NUM_GPIO_CHANNELS] = { 0 }; // HAL-internal handlers, taking precedence over irq_handler
+static uint32_t channel_hook_ids[NUM_GPIO_CHANNELS] = { 0 };
+static uint8_t channel_hook_saved[NUM_GPIO_CHANNELS] = { 0 }; // Port and edge config of the channel before it was hooked
 static gpio_irq_handler irq_handler;
 static void GPIOINT_IRQDispatcher(uint32_t iflags);
 
 static void handle_interrupt_in(uint8_t pin)
 {
     // Return if pin not linked with an interrupt function
-    if (channel_ids[pin] == 0) {
+    if ((channel_ids[pin] == 0) && (channel_hooks[pin] == NULL)) {
         return;
     }
 
@@ -80,9 +90,27 @@ static void handle_interrupt_in(uint8_t pin)
         event = IRQ_RISE;
     }
     GPIO_IntClear(pin);
+    if (channel_hooks[pin] != NULL) {
+        channel_hooks[pin](channel_hook_ids[pin], event);
+        return;
+    }
     irq_handler(channel_ids[pin], event);
 }
 
+static void gpio_irq_dispatcher_init(PinName pin)
+{
+    /* Initialize GPIO interrupt dispatcher */
+    vIRQ_SetVector(GPIO_ODD_IRQn, (uint32_t)GPIO_ODD_IRQHandler);
+    vIRQ_ClearPendingIRQ(GPIO_ODD_IRQn);
+    vIRQ_EnableIRQ(GPIO_ODD_IRQn);
+    vIRQ_SetVector(GPIO_EVEN_IRQn, (uint32_t)GPIO_EVEN_IRQHandler);
+    vIRQ_ClearPendingIRQ(GPIO_EVEN_IRQn);
+    vIRQ_EnableIRQ(GPIO_EVEN_IRQn);
+
+    // Relate the pin number to a port. If pin in is odd store in the 4 most significant bits, if pin is even store in the 4 least significant bits
+    channel_ports[(pin >> 1) & 0x7] = (pin & 0x1) ? (channel_ports[(pin >> 1) & 0x7] & 0x0F) | (pin & 0xF0) : (channel_ports[(pin >> 1) & 0x7] & 0xF0) | ((pin >> 4) & 0xF);
+}
+
 void gpio_irq_preinit(gpio_irq_t *obj, PinName pin)
 {
     MBED_ASSERT(pin != NC);
@@ -99,19 +127,11 @@ int gpio_irq_init(gpio_irq_t *obj, PinName pin, gpio_irq_handler handler, uint32
 {
     /* Init pins */
     gpio_irq_preinit(obj, pin);
-    /* Initialize GPIO interrupt dispatcher */
-    vIRQ_SetVector(GPIO_ODD_IRQn, (uint32_t)GPIO_ODD_IRQHandler);
-    vIRQ_ClearPendingIRQ(GPIO_ODD_IRQn);
-    vIRQ_EnableIRQ(GPIO_ODD_IRQn);
-    vIRQ_SetVector(GPIO_EVEN_IRQn, (uint32_t)GPIO_EVEN_IRQHandler);
-    vIRQ_ClearPendingIRQ(GPIO_EVEN_IRQn);
-    vIRQ_EnableIRQ(GPIO_EVEN_IRQn);
+    gpio_irq_dispatcher_init(obj->pin);
 
     /* Relate pin to interrupt action id */
     channel_ids[obj->pin & 0xF] = id;
 
-    // Relate the pin number to a port. If pin in is odd store in the 4 most significant bits, if pin is even store in the 4 least significant bits
-    channel_ports[(obj->pin >> 1) & 0x7] = (obj->pin & 0x1) ? (channel_ports[(obj->pin >> 1) & 0x7] & 0x0F) | (obj->pin & 0xF0) : (channel_ports[(obj->pin >> 1) & 0x7] & 0xF0) | ((obj->pin >> 4) & 0xF);
     /* Save pointer to handler */
     irq_handler = handler;
 
@@ -164,6 +184,41 @@ inline void gpio_irq_disable(gpio_irq_t *obj)
     if(GPIO->IEN == 0) unblockSleepMode(GPIO_LEAST_ACTIVE_SLEEPMODE);
 }
 
+void gpio_irq_hook(PinName pin, gpio_irq_hook_t hook, uint32_t id)
+{
+    uint8_t channel = pin & 0xF;
+    uint8_t saved;
+
+    MBED_ASSERT(pin != NC);
+
+    /* Keep the sleep mode accounting shared with gpio_irq_enable/disable */
+    if (hook != NULL) {
+        if (channel_hooks[channel] == NULL) {
+            /* The channel may belong to an InterruptIn on another port, put it back on unhook */
+            saved = (channel & 0x1) ? (channel_ports[channel >> 1] >> 4) & 0xF : channel_ports[channel >> 1] & 0xF;
+            if (GPIO->EXTIRISE & (1 << channel)) saved |= HOOK_SAVED_RISE;
+            if (GPIO->EXTIFALL & (1 << channel)) saved |= HOOK_SAVED_FALL;
+            if (GPIO->IEN & (1 << channel)) saved |= HOOK_SAVED_ENABLE;
+            channel_hook_saved[channel] = saved;
+        }
+        gpio_irq_dispatcher_init(pin);
+        channel_hooks[channel] = hook;
+        channel_hook_ids[channel] = id;
+        if(GPIO->IEN == 0) blockSleepMode(GPIO_LEAST_ACTIVE_SLEEPMODE);
+        GPIO_IntConfig((GPIO_Port_TypeDef)((pin >> 4) & 0xF), channel, true, true, true);
+    } else if (channel_hooks[channel] != NULL) {
+        saved = channel_hook_saved[channel];
+        GPIO_IntDisable(1 << channel);
+        channel_hooks[channel] = NULL;
+        channel_ports[channel >> 1] = (channel & 0x1) ? (channel_ports[channel >> 1] & 0x0F) | ((saved & HOOK_SAVED_PORT_MASK) << 4) : (channel_ports[channel >> 1] & 0xF0) | (saved & HOOK_SAVED_PORT_MASK);
+        GPIO_IntConfig((GPIO_Port_TypeDef)(saved & HOOK_SAVED_PORT_MASK), channel,
+                       (saved & HOOK_SAVED_RISE) ? true : false,
+                       (saved & HOOK_SAVED_FALL) ? true : false,
+                       (saved & HOOK_SAVED_ENABLE) ? true : false);
+        if(GPIO->IEN == 0) unblockSleepMode(GPIO_LEAST_ACTIVE_SLEEPMODE);
+    }
+}
+
 /***************************************************************************//**
  * @brief
  *   Function calls users callback for registered pin interrupts.
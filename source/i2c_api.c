@@ -29,6 +29,9 @@
 #include "mbed-drivers/mbed_assert.h"
 
 #include "mbed-hal/i2c_api.h"
+#include "mbed-hal/sleep_api.h"
+#include "mbed-hal/us_ticker_api.h"
+#include "mbed-hal-efm32/i2c_api_HAL.h"
 
 #include "mbed-hal-efm32/clocking.h"
 #include "mbed-hal-efm32/PeripheralPins.h"
@@ -46,10 +49,31 @@
 /* RXUF is only likely to occur with this SW if using a debugger peeking into */
 /* RXDATA register. Thus, we ignore those types of fault. */
 #define I2C_IF_ERRORS    (I2C_IF_BUSERR | I2C_IF_ARBLOST)
+/* Clock synchronization cycles added to each SCL period, as in em_i2c.c */
+#if defined( _SILICON_LABS_32B_PLATFORM_2 )
+#define I2C_CLOCK_CR_MAX 8
+#else
+#define I2C_CLOCK_CR_MAX 4
+#endif
+
+/* Clock low/high ratios in master mode: Nlow + Nhigh, the fastest SCL each one
+ * is meant for, and the HFPER clock it needs to be faster than (see I2C_BusFreqSet()) */
+static const struct {
+    I2C_ClockHLR_TypeDef hlr;
+    uint8_t nsum;
+    uint32_t max_scl;
+    uint32_t min_ref;
+} i2c_clock_modes[] = {
+    { i2cClockHLRStandard,  4 + 4,  100000,  2000000 },
+    { i2cClockHLRAsymetric, 6 + 3,  400000,  9000000 },
+    { i2cClockHLRFast,      11 + 6, 1000000, 20000000 },
+};
+
+/* Longest wait for the bus in blocking calls, in microseconds */
 #define I2C_TIMEOUT 100000
 
 /* Prototypes */
-int block_and_wait_for_ack(I2C_TypeDef *i2c);
+int block_and_wait_for_ack(i2c_t *obj);
 void i2c_enable(i2c_t *obj, uint8_t enable);
 void i2c_enable_pins(i2c_t *obj, uint8_t enable);
 void i2c_enable_interrupt(i2c_t *obj, uint32_t address, uint8_t enable);
@@ -104,6 +128,8 @@ void i2c_init(i2c_t *obj, PinName sda, PinName scl)
     I2CName i2c_scl = (I2CName) pinmap_peripheral(scl, PinMap_I2C_SCL);
     obj->i2c.i2c = (I2C_TypeDef*) pinmap_merge(i2c_sda, i2c_scl);
     MBED_ASSERT(((int) obj->i2c.i2c) != NC);
+    obj->i2c.sda = sda;
+    obj->i2c.scl = scl;
     
     /* You need both SDA and SCL for I2C, so configuring one of them to NC is illegal */
     MBED_ASSERT((uint32_t)sda != (uint32_t)NC);
@@ -144,6 +170,19 @@ void i2c_init(i2c_t *obj, PinName sda, PinName scl)
     /* We are assuming that there is only one master. So disable automatic arbitration */
     obj->i2c.i2c->CTRL |= _I2C_CTRL_ARBDIS_MASK;
 
+#if DEVICE_I2C_ASYNCH
+    obj->i2c.dmaOptions.dmaUsageState = DMA_USAGE_OPPORTUNISTIC;
+    obj->i2c.phase = 0;
+    obj->i2c.slave = false;
+#if DEVICE_INTERRUPTIN
+    obj->i2c.recover_handler = 0;
+    obj->i2c.recover_event = 0;
+    obj->i2c.recover_count = 0;
+    obj->i2c.recover_failed = 0;
+    obj->i2c.recover_pulses = 0;
+#endif
+#endif
+
     /* Enable i2c */
     i2c_enable(obj, true);
 }
@@ -187,35 +226,150 @@ void i2c_enable_interrupt(i2c_t *obj, uint32_t address, uint8_t enable)
     }
 }
 
-/* Set the frequency of the I2C interface */
+/* Installed while a blocking call sleeps. Waking up is all it is for, so mask the source. */
+#ifdef I2C0
+static void i2c0_wait_irq(void)
+{
+    I2C0->IEN = 0;
+}
+#endif
+#ifdef I2C1
+static void i2c1_wait_irq(void)
+{
+    I2C1->IEN = 0;
+}
+#endif
+
+/******************************************
+* static uint32_t i2c_wait(i2c_t *obj, uint32_t flags)
+*
+* Sleep in EM1 until one of the interrupt flags is set, or I2C_TIMEOUT
+* microseconds have passed. The flags wake the core through the I2C
+* interrupt. The us ticker overflow wakes it often enough to notice a
+* timeout on a bus that has gone silent.
+*
+* return: the flags that were set, 0 on timeout.
+******************************************/
+static uint32_t i2c_wait(i2c_t *obj, uint32_t flags)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    uint32_t vector = 0;
+    uint32_t pending;
+
+    switch (i2c_get_index(obj)) {
+#ifdef I2C0
+        case 0:
+            vector = (uint32_t)i2c0_wait_irq;
+            break;
+#endif
+#ifdef I2C1
+        case 1:
+            vector = (uint32_t)i2c1_wait_irq;
+            break;
+#endif
+    }
+
+    blockSleepMode(EM1);
+    i2c_enable_interrupt(obj, vector, true);
+
+    /* The wait handler masks the flags again once one of them is set */
+    i2c->IEN = flags;
+    pending = sleep_while(&(i2c->IF), flags, 0, I2C_TIMEOUT);
+    i2c->IEN = 0;
+
+    i2c_enable_interrupt(obj, 0, false);
+    unblockSleepMode(EM1);
+
+    return pending;
+}
+
+/******************************************
+* static void i2c_wait_idle(i2c_t *obj)
+*
+* Wait, at most I2C_TIMEOUT microseconds, for the peripheral to leave the
+* busy state. There is no interrupt for it, but after a stop or an abort
+* it follows within a few bit periods, so this is not worth sleeping for.
+******************************************/
+static void i2c_wait_idle(i2c_t *obj)
+{
+    uint32_t start = us_ticker_read();
+
+    while ((obj->i2c.i2c->STATE & I2C_STATE_BUSY) && ((us_ticker_read() - start) < I2C_TIMEOUT));
+}
+
+/* Set the frequency of the I2C interface. The bus is never run faster than asked
+ * for, or than the ratio and HFPER allow. At or below 2MHz HFPER, the peripheral
+ * can't generate SCL as a master at all: this asserts, and in release builds
+ * leaves the previous setting in place. */
 void i2c_frequency(i2c_t *obj, int hz)
 {
-    /* Set frequency. As the second argument is 0,
-     *  HFPER clock frequency is used as reference freq */
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    /* The clock actually feeding the peripheral, which may differ from the configured core clock */
+    uint32_t ref = CMU_ClockFreqGet(cmuClock_HFPER);
+    uint32_t max;
+    int mode;
+
     if (hz <= 0) return;
-    /* In I2C Normal mode (50% duty), we can go up to 100kHz */
+    /* Cap requested frequency at 1MHz */
+    if (hz > 1000000) hz = 1000000;
+
+    /* Normal mode (4:4 ratio) up to 100kHz, Fast mode (6:3) up to 400kHz, Fast+ mode (11:6) beyond */
     if (hz <= 100000) {
-        I2C_BusFreqSet(obj->i2c.i2c, REFERENCE_FREQUENCY, hz, i2cClockHLRStandard);
+        mode = 0;
+    } else if (hz <= 400000) {
+        mode = 1;
+    } else {
+        mode = 2;
+    }
+
+    /* Fall back to a more relaxed ratio when HFPER is too slow for the one asked for */
+    while (mode > 0 && ref <= i2c_clock_modes[mode].min_ref) {
+        mode--;
     }
-    /* In I2C Fast mode (6:3 ratio), we can go up to 400kHz */
-    else if (hz <= 400000) {
-        I2C_BusFreqSet(obj->i2c.i2c, REFERENCE_FREQUENCY, hz, i2cClockHLRAsymetric);
+    /* Not even the standard ratio works, and emlib would reject it as well */
+    MBED_ASSERT(ref > i2c_clock_modes[0].min_ref);
+    if (ref <= i2c_clock_modes[0].min_ref) {
+        return;
     }
-    /* In I2C Fast+ mode (11:6 ratio), we can go up to 1 MHz */
-    else if (hz <= 1000000) {
-        I2C_BusFreqSet(obj->i2c.i2c, REFERENCE_FREQUENCY, hz, i2cClockHLRFast);
+
+    /* Don't ask for more than the ratio is meant for, or than HFPER can give with a divider of 1 */
+    max = ref / (i2c_clock_modes[mode].nsum + I2C_CLOCK_CR_MAX);
+    if (max > i2c_clock_modes[mode].max_scl) {
+        max = i2c_clock_modes[mode].max_scl;
     }
-    /* Cap requested frequency at 1MHz */
-    else {
-        I2C_BusFreqSet(obj->i2c.i2c, REFERENCE_FREQUENCY, 1000000, i2cClockHLRFast);
+    if ((uint32_t)hz > max) {
+        hz = max;
+    }
+
+    I2C_BusFreqSet(i2c, ref, hz, i2c_clock_modes[mode].hlr);
+
+    /* The divider is rounded down, so the bus may come out faster than asked. One step more is always slower. */
+    if ((I2C_BusFreqGet(i2c) > (uint32_t)hz) && (i2c->CLKDIV < _I2C_CLKDIV_DIV_MASK)) {
+        i2c->CLKDIV++;
     }
 }
 
+/* The blocking calls borrow the I2C interrupt to sleep. The asynchronous slave,
+ * transfers run by the HAL and bus recovery own it until they are done. */
+static bool i2c_owned_asynch(i2c_t *obj)
+{
+#if DEVICE_I2C_ASYNCH
+    return obj->i2c.slave || obj->i2c.phase;
+#else
+    (void) obj;
+    return false;
+#endif
+}
+
 /* Creates a start condition on the I2C bus */
 int i2c_start(i2c_t *obj)
 {
     I2C_TypeDef *i2c = obj->i2c.i2c;
 
+    if (i2c_owned_asynch(obj)) {
+        return I2C_ERROR_BUS_BUSY;
+    }
+
     /* Ensure buffers are empty */
     i2c->CMD = I2C_CMD_CLEARPC | I2C_CMD_CLEARTX;
     if (i2c->IF & I2C_IF_RXDATAV) {
@@ -233,11 +387,15 @@ int i2c_start(i2c_t *obj)
 /* Creates a stop condition on the I2C bus */
 int i2c_stop(i2c_t *obj)
 {
+    if (i2c_owned_asynch(obj)) {
+        return I2C_ERROR_BUS_BUSY;
+    }
+
     obj->i2c.i2c->CMD = I2C_CMD_STOP;
 
     /* Wait for the stop to be sent */
-    int timeout = I2C_TIMEOUT;
-    while (!(obj->i2c.i2c->IF & I2C_IF_MSTOP) && !timeout--);
+    i2c_wait(obj, I2C_IF_MSTOP);
+    obj->i2c.i2c->IFC = I2C_IFC_MSTOP;
 
     return 0;
 }
@@ -247,12 +405,14 @@ int i2c_read(i2c_t *obj, int address, char *data, int length, int stop)
 {
     int retval;
 
-    i2c_start(obj);
+    if (i2c_start(obj) != 0) {
+        return I2C_ERROR_BUS_BUSY;
+    }
 
     retval = i2c_byte_write(obj, (address | 1));
     if ((!retval) || (length == 0)) { //Write address with W flag (last bit 1)
         obj->i2c.i2c->CMD = I2C_CMD_STOP | I2C_CMD_ABORT;
-        while(obj->i2c.i2c->STATE & I2C_STATE_BUSY); // Wait until the bus is done
+        i2c_wait_idle(obj); // Wait until the bus is done
         return (retval == 0 ? I2C_ERROR_NO_SLAVE : 0); //NACK or error when writing adress. Return 0 as 0 bytes were read
     }
     int i = 0;
@@ -270,7 +430,9 @@ int i2c_read(i2c_t *obj, int address, char *data, int length, int stop)
 
 int i2c_write(i2c_t *obj, int address, const char *data, int length, int stop)
 {
-    i2c_start(obj);
+    if (i2c_start(obj) != 0) {
+        return I2C_ERROR_BUS_BUSY;
+    }
 
     if (!i2c_byte_write(obj, (address & 0xFE))) {
         i2c_stop(obj);
@@ -299,11 +461,12 @@ void i2c_reset(i2c_t *obj)
 
 int i2c_byte_read(i2c_t *obj, int last)
 {
-    int timeout = I2C_TIMEOUT;
-    /* Wait for data */
-    while (!(obj->i2c.i2c->STATUS & I2C_STATUS_RXDATAV) && timeout--);
+    if (i2c_owned_asynch(obj)) {
+        return I2C_ERROR_BUS_BUSY;
+    }
 
-    if (timeout <= 0) {
+    /* Wait for data */
+    if (!(i2c_wait(obj, I2C_IF_RXDATAV) & I2C_IF_RXDATAV)) {
         return 0; //TODO Is this the correct way to handle this?
     }
     char data = obj->i2c.i2c->RXDATA;
@@ -318,41 +481,42 @@ int i2c_byte_read(i2c_t *obj, int last)
 
 int i2c_byte_write(i2c_t *obj, int data)
 {
+    if (i2c_owned_asynch(obj)) {
+        return I2C_ERROR_BUS_BUSY;
+    }
+
     obj->i2c.i2c->TXDATA = data;
-    return block_and_wait_for_ack(obj->i2c.i2c);
+    return block_and_wait_for_ack(obj);
 }
 
 /*
  * Returns 1 for ACK. 0 for NACK, timeout or error.
  */
-int block_and_wait_for_ack(I2C_TypeDef *i2c)
+int block_and_wait_for_ack(i2c_t *obj)
 {
-    uint32_t pending;
-    uint32_t timeout = I2C_TIMEOUT;
-    while (timeout > 0) {
-        timeout -= 1;
-        pending = i2c->IF;
-        /* If some sort of fault, abort transfer. */
-        if (pending & I2C_IF_ERRORS) {
-            if (pending & I2C_IF_ARBLOST) {
-                /* If arbitration fault, it indicates either a slave device */
-                /* not responding as expected, or other master which is not */
-                /* supported by this SW. */
-                return 0;
-            } else if (pending & I2C_IF_BUSERR) {
-                /* A bus error indicates a misplaced start or stop, which should */
-                /* not occur in master mode controlled by this SW. */
-                return 0;
-            }
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    uint32_t pending = i2c_wait(obj, I2C_IF_ACK | I2C_IF_NACK | I2C_IF_ERRORS);
+
+    /* If some sort of fault, abort transfer. */
+    if (pending & I2C_IF_ERRORS) {
+        if (pending & I2C_IF_ARBLOST) {
+            /* If arbitration fault, it indicates either a slave device */
+            /* not responding as expected, or other master which is not */
+            /* supported by this SW. */
+            return 0;
+        } else if (pending & I2C_IF_BUSERR) {
+            /* A bus error indicates a misplaced start or stop, which should */
+            /* not occur in master mode controlled by this SW. */
+            return 0;
         }
+    }
 
-        if (pending & I2C_IF_NACK) {
-            i2c->IFC = I2C_IFC_NACK;
-            return 0; //Received NACK
-        } else if (pending & I2C_IF_ACK) {
-            i2c->IFC = I2C_IFC_ACK;
-            return 1; //Got ACK
-        }
+    if (pending & I2C_IF_NACK) {
+        i2c->IFC = I2C_IFC_NACK;
+        return 0; //Received NACK
+    } else if (pending & I2C_IF_ACK) {
+        i2c->IFC = I2C_IFC_ACK;
+        return 1; //Got ACK
     }
     return 0; //Timeout
 }
@@ -362,8 +526,931 @@ int block_and_wait_for_ack(I2C_TypeDef *i2c)
 #include "em_dma.h"
 #include "dma_api_HAL.h"
 #include "dma_api.h"
-#include "sleep_api.h"
 #include "mbed-hal/buffer.h"
+#include "em_gpio.h"
+#if DEVICE_INTERRUPTIN
+#include "mbed-hal-efm32/gpio_irq_api_HAL.h"
+#endif
+
+/* Phases of a transfer run by the HAL state machine */
+#define I2C_PHASE_WRITE         1
+#define I2C_PHASE_READ          2
+#define I2C_PHASE_STOP          3
+/* Phases of an addressed slave transaction */
+#define I2C_PHASE_SLAVE_IDLE    4
+#define I2C_PHASE_SLAVE_REG     5
+#define I2C_PHASE_SLAVE_RX      6
+#define I2C_PHASE_SLAVE_TX      7
+/* SCL is driven as GPIO to free the bus */
+#define I2C_PHASE_RECOVER       8
+
+/* Sent by the slave when the host reads past the end of a register */
+#define I2C_SLAVE_FILL          0xFF
+
+/* Clock pulses that let any slave finish the byte it is sending, plus its ACK bit */
+#define I2C_RECOVER_PULSES      9
+#define I2C_RECOVER_HALF_PERIOD_US  5
+
+#ifdef LDMA_PRESENT
+/* LDMA writes CTRL in sync with the RXDATAV request of the last byte, before it is ACKed */
+#define I2C_DMA_RX              1
+#else
+/* A classic DMA memory task only runs on the next RXDATAV request, after AUTOACK
+ * has already ACKed the last byte. Reception stays in the interrupt. */
+#define I2C_DMA_RX              0
+#endif
+
+static void i2c_segment_end(i2c_t *obj);
+
+/******************************************
+* static void i2c_enable_dma(i2c_t *obj, DMAUsage state)
+*
+* Acquire or release the DMA channel as indicated by the hint, like
+* spi_enable_dma does for SPI. Only one channel is used, since the
+* data phases of a transfer never overlap.
+******************************************/
+static void i2c_enable_dma(i2c_t *obj, DMAUsage state)
+{
+    int channel;
+
+    if (state == DMA_USAGE_ALWAYS && obj->i2c.dmaOptions.dmaUsageState != DMA_USAGE_ALLOCATED) {
+        /* Try to allocate a channel */
+        channel = dma_channel_allocate(DMA_CAP_NONE);
+        if (channel != DMA_ERROR_OUT_OF_CHANNELS) {
+            obj->i2c.dmaOptions.dmaChannel = channel;
+            obj->i2c.dmaOptions.dmaUsageState = DMA_USAGE_ALLOCATED;
+        } else {
+            obj->i2c.dmaOptions.dmaUsageState = state;
+        }
+    } else if (state == DMA_USAGE_OPPORTUNISTIC) {
+        if (obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_ALLOCATED) {
+            /* Channel has already been allocated previously by an ALWAYS state, so after this transfer, we will release it */
+            obj->i2c.dmaOptions.dmaUsageState = DMA_USAGE_TEMPORARY_ALLOCATED;
+        } else {
+            /* Try to allocate a channel */
+            channel = dma_channel_allocate(DMA_CAP_NONE);
+            if (channel != DMA_ERROR_OUT_OF_CHANNELS) {
+                obj->i2c.dmaOptions.dmaChannel = channel;
+                obj->i2c.dmaOptions.dmaUsageState = DMA_USAGE_TEMPORARY_ALLOCATED;
+            } else {
+                obj->i2c.dmaOptions.dmaUsageState = state;
+            }
+        }
+    } else if (state == DMA_USAGE_NEVER) {
+        /* If a channel is allocated, get rid of it */
+        if (obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_ALLOCATED) {
+            dma_channel_free(obj->i2c.dmaOptions.dmaChannel);
+        }
+        obj->i2c.dmaOptions.dmaUsageState = DMA_USAGE_NEVER;
+    }
+}
+
+static bool i2c_dma_channel_enabled(i2c_t *obj)
+{
+#ifdef LDMA_PRESENT
+    return LDMAx_ChannelEnabled(obj->i2c.dmaOptions.dmaChannel);
+#else
+    return DMA_ChannelEnabled(obj->i2c.dmaOptions.dmaChannel);
+#endif
+}
+
+/* End of the DMA part of a data phase. On reception only the last byte is left, to be
+ * (N)ACKed from the I2C interrupt. On slave transmission the interrupt takes over with fill bytes. */
+static void i2c_dma_done(unsigned int channel, bool primary, void *user)
+{
+    i2c_t *obj = (i2c_t *)user;
+    (void) channel;
+    (void) primary;
+
+    obj->i2c.i2c->IEN |= (obj->i2c.phase == I2C_PHASE_SLAVE_TX) ? I2C_IEN_TXBL : I2C_IEN_RXDATAV;
+}
+
+/******************************************
+* static void i2c_dma_activate(i2c_t *obj, uint8_t *data, uint16_t len, bool read)
+*
+* Hand a data phase to DMA. A write moves all bytes to TXDATA. A read
+* moves all but the last byte from RXDATA with AUTOACK set, and then
+* writes CTRL without AUTOACK straight from DMA, so the last byte is
+* held for a NACK regardless of interrupt latency. Only LDMA can do the
+* latter (see I2C_DMA_RX), the classic controller only handles writes.
+******************************************/
+#ifdef LDMA_PRESENT
+static void i2c_dma_activate(i2c_t *obj, uint8_t *data, uint16_t len, bool read)
+{
+    LDMA_PeripheralSignal_t tx_periph, rx_periph;
+
+    switch ((int)obj->i2c.i2c) {
+#ifdef I2C0
+        case I2C_0:
+            tx_periph = ldmaPeripheralSignal_I2C0_TXBL;
+            rx_periph = ldmaPeripheralSignal_I2C0_RXDATAV;
+            break;
+#endif
+#ifdef I2C1
+        case I2C_1:
+            tx_periph = ldmaPeripheralSignal_I2C1_TXBL;
+            rx_periph = ldmaPeripheralSignal_I2C1_RXDATAV;
+            break;
+#endif
+        default:
+            EFM_ASSERT(0);
+            while(1);
+            break;
+    }
+
+    if (read) {
+        LDMA_Descriptor_t desc = LDMA_DESCRIPTOR_LINKREL_P2M_BYTE(&(obj->i2c.i2c->RXDATA), data, len - 1, 1);
+        LDMA_Descriptor_t ctrl = LDMA_DESCRIPTOR_SINGLE_WRITE(obj->i2c.dma_ctrl, &(obj->i2c.i2c->CTRL));
+        desc.xfer.doneIfs = 0;
+        obj->i2c.dma_desc[0] = desc;
+        obj->i2c.dma_desc[1] = ctrl;
+
+        LDMA_TransferCfg_t xferConf = LDMA_TRANSFER_CFG_PERIPHERAL(rx_periph);
+        LDMAx_StartTransfer(obj->i2c.dmaOptions.dmaChannel, &xferConf, obj->i2c.dma_desc, i2c_dma_done, obj);
+    } else {
+        LDMA_Descriptor_t desc = LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(data, &(obj->i2c.i2c->TXDATA), len);
+        /* The end of a master write is picked up from BUSHOLD, no need to interrupt */
+        desc.xfer.doneIfs = (obj->i2c.phase == I2C_PHASE_SLAVE_TX);
+        obj->i2c.dma_desc[0] = desc;
+
+        LDMA_TransferCfg_t xferConf = LDMA_TRANSFER_CFG_PERIPHERAL(tx_periph);
+        LDMAx_StartTransfer(obj->i2c.dmaOptions.dmaChannel, &xferConf, obj->i2c.dma_desc, i2c_dma_done, obj);
+    }
+}
+#else
+static void i2c_dma_activate(i2c_t *obj, uint8_t *data, uint16_t len, bool read)
+{
+    DMA_CfgChannel_TypeDef chnlCfg;
+    DMA_CfgDescrSGAlt_TypeDef descrCfg;
+
+    MBED_ASSERT(!read);
+
+    obj->i2c.dmaOptions.dmaCallback.cbFunc = i2c_dma_done;
+    obj->i2c.dmaOptions.dmaCallback.userPtr = obj;
+
+    chnlCfg.highPri   = false;
+    chnlCfg.enableInt = (obj->i2c.phase == I2C_PHASE_SLAVE_TX);
+    chnlCfg.cb        = &(obj->i2c.dmaOptions.dmaCallback);
+
+    switch ((int)obj->i2c.i2c) {
+#ifdef I2C0
+        case I2C_0:
+            chnlCfg.select = DMAREQ_I2C0_TXBL;
+            break;
+#endif
+#ifdef I2C1
+        case I2C_1:
+            chnlCfg.select = DMAREQ_I2C1_TXBL;
+            break;
+#endif
+        default:
+            printf("I2C module not available.. Out of bound access. (dma)");
+            break;
+    }
+    DMA_CfgChannel(obj->i2c.dmaOptions.dmaChannel, &chnlCfg);
+
+    /* Forget the previous run, i2c_dma_progress() reads the alternate descriptor */
+    DMA_DESCRIPTOR_TypeDef *alt = ((DMA_DESCRIPTOR_TypeDef *)(DMA->ALTCTRLBASE)) + obj->i2c.dmaOptions.dmaChannel;
+    alt->SRCEND = NULL;
+    alt->DSTEND = NULL;
+
+    descrCfg.arbRate = dmaArbitrate1;
+    descrCfg.hprot = 0;
+    descrCfg.size = dmaDataSize1;
+
+    descrCfg.src = data;
+    descrCfg.srcInc = dmaDataInc1;
+    descrCfg.dst = (void *)&(obj->i2c.i2c->TXDATA);
+    descrCfg.dstInc = dmaDataIncNone;
+    descrCfg.nMinus1 = len - 1;
+    descrCfg.peripheral = true;
+    DMA_CfgDescrScatterGather(obj->i2c.dma_desc, 0, &descrCfg);
+
+    DMA_ActivateScatterGather(obj->i2c.dmaOptions.dmaChannel, false, obj->i2c.dma_desc, 1);
+}
+#endif // LDMA_PRESENT
+
+/******************************************
+* static uint16_t i2c_dma_progress(i2c_t *obj, const uint8_t *data, uint16_t len, bool read)
+*
+* Amount of bytes the DMA part of a data phase has moved so far, for
+* phases cut short by the other side. len is the length of the DMA part.
+******************************************/
+static uint16_t i2c_dma_progress(i2c_t *obj, const uint8_t *data, uint16_t len, bool read)
+{
+    uint32_t next;
+
+#ifdef LDMA_PRESENT
+    /* Points at the next byte to be moved, or at CTRL once a read moved on to its last descriptor */
+    next = read ? LDMA->CH[obj->i2c.dmaOptions.dmaChannel].DST : LDMA->CH[obj->i2c.dmaOptions.dmaChannel].SRC;
+#else
+    /* Each scatter-gather task is copied into the alternate descriptor when started */
+    DMA_DESCRIPTOR_TypeDef *descr = ((DMA_DESCRIPTOR_TypeDef *)(DMA->ALTCTRLBASE)) + obj->i2c.dmaOptions.dmaChannel;
+    uint32_t ctrl = descr->CTRL;
+    uint32_t remaining = 0;
+
+    /* A descriptor that has run to completion is marked invalid */
+    if (ctrl & _DMA_CTRL_CYCLE_CTRL_MASK) {
+        remaining = ((ctrl & _DMA_CTRL_N_MINUS_1_MASK) >> _DMA_CTRL_N_MINUS_1_SHIFT) + 1;
+    }
+    next = (uint32_t)(read ? descr->DSTEND : descr->SRCEND) + 1 - remaining;
+#endif
+
+    /* Not started yet */
+    if (next < (uint32_t)data) {
+        return 0;
+    }
+    next -= (uint32_t)data;
+    return (next < len ? next : len);
+}
+
+/******************************************
+* static void i2c_segment_start(i2c_t *obj)
+*
+* (Repeated) start and address for segments[seg_index], unless it
+* continues the previous write, then its data phase. Data goes through
+* DMA when a channel is held, and byte by byte from the interrupt
+* otherwise, or when a segment is too short to be worth it.
+******************************************/
+static void i2c_segment_start(i2c_t *obj)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    const i2c_segment_t *seg = &(obj->i2c.segments[obj->i2c.seg_index]);
+    bool read = (seg->flags & I2C_SEGMENT_READ) ? true : false;
+    bool dma = (obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_ALLOCATED || obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED);
+
+    obj->i2c.use_dma = dma && (read ? (I2C_DMA_RX && seg->length > 1) : (seg->length > 0));
+    obj->i2c.seg_offset = 0;
+    i2c->IFC = _I2C_IFC_MASK;
+
+    if (read) {
+        MBED_ASSERT(seg->length > 0 && !(seg->flags & I2C_SEGMENT_NOSTART));
+        obj->i2c.phase = I2C_PHASE_READ;
+        if (obj->i2c.use_dma) {
+            /* Reception starts as soon as the address is acknowledged, so arm beforehand */
+            i2c->CTRL |= I2C_CTRL_AUTOACK;
+            i2c_dma_activate(obj, seg->data, seg->length, true);
+            i2c->IEN = I2C_IF_NACK | I2C_IF_ERRORS;
+        } else {
+            i2c->IEN = I2C_IF_NACK | I2C_IF_ERRORS | I2C_IF_RXDATAV;
+        }
+        i2c->CMD = I2C_CMD_START;
+        i2c->TXDATA = seg->address | 1;
+        return;
+    }
+
+    obj->i2c.phase = I2C_PHASE_WRITE;
+    i2c->IEN = I2C_IF_NACK | I2C_IF_ERRORS | (obj->i2c.use_dma ? I2C_IF_BUSHOLD : I2C_IF_ACK);
+
+    if (seg->flags & I2C_SEGMENT_NOSTART) {
+        /* The bus is held after the previous write, just carry on with the data */
+        if (obj->i2c.use_dma) {
+            i2c_dma_activate(obj, seg->data, seg->length, false);
+        } else if (seg->length > 0) {
+            i2c->TXDATA = seg->data[obj->i2c.seg_offset++];
+        } else {
+            i2c_segment_end(obj);
+        }
+        return;
+    }
+
+    i2c->CMD = I2C_CMD_START;
+    i2c->TXDATA = seg->address & 0xFE;
+    if (obj->i2c.use_dma) {
+        /* Only now TXDATA is taken, so DMA can't get in ahead of the address */
+        i2c_dma_activate(obj, seg->data, seg->length, false);
+    }
+}
+
+/******************************************
+* static void i2c_segment_end(i2c_t *obj)
+*
+* The data phase of segments[seg_index] is done. Go on with the next
+* segment, after a stop condition if asked for or if it was the last.
+******************************************/
+static void i2c_segment_end(i2c_t *obj)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    const i2c_segment_t *seg = &(obj->i2c.segments[obj->i2c.seg_index]);
+
+    if ((obj->i2c.seg_index + 1 < obj->i2c.seg_count) && !(seg->flags & I2C_SEGMENT_STOP)) {
+        obj->i2c.seg_index++;
+        i2c_segment_start(obj);
+        return;
+    }
+
+    obj->i2c.phase = I2C_PHASE_STOP;
+    i2c->IFC = I2C_IFC_MSTOP;
+    i2c->IEN = I2C_IF_ERRORS | I2C_IF_MSTOP;
+    i2c->CMD = I2C_CMD_STOP;
+}
+
+/* Tear down a transfer run by the HAL state machine and report the event */
+static uint32_t i2c_segments_finish(i2c_t *obj, uint32_t event)
+{
+    obj->i2c.i2c->IEN = 0;
+    obj->i2c.i2c->CTRL &= ~I2C_CTRL_AUTOACK;
+    i2c_enable_interrupt(obj, 0, false);
+
+    if (obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_ALLOCATED || obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
+        if (i2c_dma_channel_enabled(obj)) {
+#ifdef LDMA_PRESENT
+            LDMA_StopTransfer(obj->i2c.dmaOptions.dmaChannel);
+#else
+            DMA_ChannelEnable(obj->i2c.dmaOptions.dmaChannel, false);
+#endif
+        }
+
+        /* Release the dma channel if it was opportunistically allocated */
+        if (obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
+            dma_channel_free(obj->i2c.dmaOptions.dmaChannel);
+            obj->i2c.dmaOptions.dmaUsageState = DMA_USAGE_OPPORTUNISTIC;
+        }
+    }
+
+    obj->i2c.phase = 0;
+    unblockSleepMode(EM1);
+
+    return event & obj->i2c.events;
+}
+
+/******************************************
+* static uint32_t i2c_segments_irq_handler(i2c_t *obj)
+*
+* I2C interrupt during a transfer run by the HAL state machine. With DMA,
+* only the ends of data phases and errors get here.
+*
+* return: event mask. Non-zero once the transfer has terminated.
+******************************************/
+static uint32_t i2c_segments_irq_handler(i2c_t *obj)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    const i2c_segment_t *seg = &(obj->i2c.segments[obj->i2c.seg_index]);
+    uint32_t pending = i2c->IF & i2c->IEN;
+
+    if (pending & I2C_IF_ERRORS) {
+        i2c->CMD = I2C_CMD_ABORT;
+        return i2c_segments_finish(obj, I2C_EVENT_ERROR);
+    }
+
+    if (pending & I2C_IF_NACK) {
+        /* The bus is held after a NACK, so the state still tells what was refused */
+        bool address = ((i2c->STATE & _I2C_STATE_STATE_MASK) == I2C_STATE_STATE_ADDRACK);
+        i2c->IFC = I2C_IFC_NACK;
+        i2c->CMD = I2C_CMD_STOP;
+        return i2c_segments_finish(obj, address ? I2C_EVENT_ERROR_NO_SLAVE : I2C_EVENT_TRANSFER_EARLY_NACK);
+    }
+
+    switch (obj->i2c.phase) {
+        case I2C_PHASE_WRITE:
+            if (obj->i2c.use_dma) {
+                i2c->IFC = I2C_IFC_BUSHOLD;
+                /* The bus is also held when DMA falls behind, so check that everything went out */
+                if (!(i2c->STATE & I2C_STATE_BUSHOLD) || !(i2c->STATUS & I2C_STATUS_TXBL) || i2c_dma_channel_enabled(obj)) {
+                    return 0;
+                }
+            } else {
+                if (!(pending & I2C_IF_ACK)) {
+                    return 0;
+                }
+                i2c->IFC = I2C_IFC_ACK;
+                if (obj->i2c.seg_offset < seg->length) {
+                    i2c->TXDATA = seg->data[obj->i2c.seg_offset++];
+                    return 0;
+                }
+            }
+            i2c_segment_end(obj);
+            return 0;
+        case I2C_PHASE_READ:
+            if (!(pending & I2C_IF_RXDATAV)) {
+                return 0;
+            }
+            if (obj->i2c.use_dma) {
+                /* DMA took care of all but the last byte */
+                obj->i2c.seg_offset = seg->length - 1;
+            }
+            seg->data[obj->i2c.seg_offset++] = i2c->RXDATA;
+            if (obj->i2c.seg_offset < seg->length) {
+                i2c->CMD = I2C_CMD_ACK;
+                return 0;
+            }
+            i2c->CMD = I2C_CMD_NACK;
+            i2c_segment_end(obj);
+            return 0;
+        case I2C_PHASE_STOP:
+            if (!(pending & I2C_IF_MSTOP)) {
+                return 0;
+            }
+            i2c->IFC = I2C_IFC_MSTOP;
+            /* A stop in the middle of the list, start over with the next segment */
+            if (obj->i2c.seg_index + 1 < obj->i2c.seg_count) {
+                obj->i2c.seg_index++;
+                i2c_segment_start(obj);
+                return 0;
+            }
+            return i2c_segments_finish(obj, I2C_EVENT_TRANSFER_COMPLETE);
+        default:
+            return 0;
+    }
+}
+
+/******************************************
+* static void i2c_segments_start(i2c_t *obj, const i2c_segment_t *segments, uint8_t count, uint32_t handler)
+*
+* Run a segment list on the HAL state machine. DMA has been set up
+* according to the hint already.
+******************************************/
+static void i2c_segments_start(i2c_t *obj, const i2c_segment_t *segments, uint8_t count, uint32_t handler)
+{
+    // Ensure buffers are empty
+    obj->i2c.i2c->CMD = I2C_CMD_CLEARPC | I2C_CMD_CLEARTX;
+    if (obj->i2c.i2c->IF & I2C_IF_RXDATAV) {
+        (void) obj->i2c.i2c->RXDATA;
+    }
+
+    obj->i2c.segments = segments;
+    obj->i2c.seg_count = count;
+    obj->i2c.seg_index = 0;
+#ifdef LDMA_PRESENT
+    obj->i2c.dma_ctrl = obj->i2c.i2c->CTRL & ~I2C_CTRL_AUTOACK;
+#endif
+
+    blockSleepMode(EM1);
+    i2c_enable_interrupt(obj, handler, true);
+    i2c_segment_start(obj);
+}
+
+int i2c_transfer_list_asynch(i2c_t *obj, const i2c_segment_t *segments, uint8_t count, uint32_t handler, uint32_t event, DMAUsage hint)
+{
+    MBED_ASSERT(segments != NULL && count > 0);
+    MBED_ASSERT(!(segments[0].flags & I2C_SEGMENT_NOSTART));
+
+    /* The slave owns the peripheral and its interrupt until i2c_slave_disable_asynch() */
+    if (obj->i2c.slave || i2c_active(obj)) {
+        return I2C_ERROR_BUS_BUSY;
+    }
+
+    // Store event flags
+    obj->i2c.events = event;
+
+    dma_init();
+    i2c_enable_dma(obj, hint);
+    i2c_segments_start(obj, segments, count, handler);
+
+    return 0;
+}
+
+/* Interrupts of an enabled slave, addressed or not */
+#define I2C_SLAVE_IEN           (I2C_IF_ADDR | I2C_IF_SSTOP | I2C_IF_ERRORS)
+
+/******************************************
+* static void i2c_slave_phase_end(i2c_t *obj)
+*
+* The data phase of a slave transaction is over, because of a stop, a
+* repeated start or a NACK from the host. Stop DMA, drop what is left in
+* the buffers and tell the register file how much has been moved.
+******************************************/
+static void i2c_slave_phase_end(i2c_t *obj)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    uint8_t phase = obj->i2c.phase;
+    uint16_t count = obj->i2c.seg_offset;
+
+    if (phase != I2C_PHASE_SLAVE_RX && phase != I2C_PHASE_SLAVE_TX) {
+        return;
+    }
+
+    if (obj->i2c.use_dma) {
+        if (i2c_dma_channel_enabled(obj)) {
+#ifdef LDMA_PRESENT
+            LDMA_StopTransfer(obj->i2c.dmaOptions.dmaChannel);
+#else
+            DMA_ChannelEnable(obj->i2c.dmaOptions.dmaChannel, false);
+#endif
+        }
+        if (phase == I2C_PHASE_SLAVE_RX) {
+            count = i2c_dma_progress(obj, obj->i2c.slave_data, obj->i2c.slave_length - 1, true);
+        } else {
+            count = i2c_dma_progress(obj, obj->i2c.slave_data, obj->i2c.slave_length, false);
+        }
+    }
+
+    if (phase == I2C_PHASE_SLAVE_TX) {
+        /* A data byte still waiting in TXDATA has not been taken by the host */
+        if (!obj->i2c.slave_fill && !(i2c->STATUS & I2C_STATUS_TXBL) && count > 0) {
+            count--;
+        }
+        i2c->CMD = I2C_CMD_CLEARTX;
+    }
+
+    i2c->CTRL &= ~I2C_CTRL_AUTOACK;
+    i2c->IEN = I2C_SLAVE_IEN;
+    obj->i2c.use_dma = false;
+    obj->i2c.phase = I2C_PHASE_SLAVE_IDLE;
+
+    if (obj->i2c.regfile->done != NULL) {
+        obj->i2c.regfile->done(obj->i2c.regfile->context, obj->i2c.slave_reg, (phase == I2C_PHASE_SLAVE_TX), count);
+    }
+}
+
+/******************************************
+* static void i2c_slave_phase_start(i2c_t *obj, bool read)
+*
+* Ask the register file for the buffer of the selected register and set
+* up the data phase. The bus is held until the caller ACKs the address
+* or register byte, so DMA is in place before the first data byte.
+******************************************/
+static void i2c_slave_phase_start(i2c_t *obj, bool read)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    bool dma = (obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_ALLOCATED || obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED);
+    uint16_t length = 0;
+
+    obj->i2c.slave_data = obj->i2c.regfile->access(obj->i2c.regfile->context, obj->i2c.slave_reg, read, &length);
+    if (obj->i2c.slave_data == NULL) {
+        length = 0;
+    }
+    obj->i2c.slave_length = length;
+    obj->i2c.seg_offset = 0;
+    obj->i2c.slave_fill = false;
+    obj->i2c.use_dma = dma && (length > 1) && (read || I2C_DMA_RX);
+
+    if (read) {
+        obj->i2c.phase = I2C_PHASE_SLAVE_TX;
+        i2c->CMD = I2C_CMD_CLEARTX;
+        i2c->IFC = I2C_IFC_ACK | I2C_IFC_NACK;
+        if (obj->i2c.use_dma) {
+            /* DMA keeps TXDATA filled, the NACK of the host ends the phase */
+            i2c->IEN = I2C_SLAVE_IEN | I2C_IF_NACK;
+            i2c_dma_activate(obj, obj->i2c.slave_data, length, false);
+        } else {
+            /* One byte at a time, the next one goes out on the ACK of the previous */
+            i2c->IEN = I2C_SLAVE_IEN | I2C_IF_NACK | I2C_IF_ACK;
+            if (length > 0) {
+                i2c->TXDATA = obj->i2c.slave_data[obj->i2c.seg_offset++];
+            } else {
+                obj->i2c.slave_fill = true;
+                i2c->TXDATA = I2C_SLAVE_FILL;
+            }
+        }
+    } else {
+        obj->i2c.phase = I2C_PHASE_SLAVE_RX;
+        if (obj->i2c.use_dma) {
+            /* All but the last byte are ACKed by hardware, as for a master read */
+            i2c->CTRL |= I2C_CTRL_AUTOACK;
+            i2c->IEN = I2C_SLAVE_IEN;
+            i2c_dma_activate(obj, obj->i2c.slave_data, length, true);
+        } else {
+            i2c->IEN = I2C_SLAVE_IEN | I2C_IF_RXDATAV;
+        }
+    }
+}
+
+/******************************************
+* static void i2c_slave_release(i2c_t *obj)
+*
+* End of an addressed transaction. Sleep is no longer blocked, so the
+* next address match may have to wake the chip from EM2/EM3.
+******************************************/
+static void i2c_slave_release(i2c_t *obj)
+{
+    if (obj->i2c.phase) {
+        i2c_slave_phase_end(obj);
+        obj->i2c.phase = 0;
+        unblockSleepMode(EM1);
+    }
+}
+
+/******************************************
+* static uint32_t i2c_slave_irq_handler(i2c_t *obj)
+*
+* I2C interrupt of an asynchronous slave. The first byte the host writes
+* in a transaction selects the register, further writes go to it and
+* reads come from it, through the register file callbacks.
+*
+* return: event mask, non-zero on a bus error only.
+******************************************/
+static uint32_t i2c_slave_irq_handler(i2c_t *obj)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    uint32_t pending = i2c->IF & i2c->IEN;
+
+    if (pending & I2C_IF_ERRORS) {
+        i2c->IFC = I2C_IF_ERRORS;
+        i2c->CMD = I2C_CMD_ABORT;
+        i2c_slave_release(obj);
+        return I2C_EVENT_ERROR & obj->i2c.events;
+    }
+
+    if (pending & I2C_IF_ADDR) {
+        /* The address byte is waiting in RXDATA, its last bit is the direction */
+        bool read = (i2c->RXDATA & 1) ? true : false;
+        i2c->IFC = I2C_IFC_ADDR | I2C_IFC_RSTART;
+
+        if (obj->i2c.phase == 0) {
+            /* Stay out of EM2 until the stop, DMA and the bus clock need HFPER */
+            blockSleepMode(EM1);
+        } else {
+            /* Repeated start */
+            i2c_slave_phase_end(obj);
+        }
+
+        if (read) {
+            i2c_slave_phase_start(obj, true);
+        } else {
+            obj->i2c.phase = I2C_PHASE_SLAVE_REG;
+            i2c->IEN = I2C_SLAVE_IEN | I2C_IF_RXDATAV;
+        }
+        i2c->CMD = I2C_CMD_ACK;
+        return 0;
+    }
+
+    if (pending & I2C_IF_SSTOP) {
+        i2c->IFC = I2C_IFC_SSTOP;
+        i2c_slave_release(obj);
+        return 0;
+    }
+
+    switch (obj->i2c.phase) {
+        case I2C_PHASE_SLAVE_REG:
+            if (pending & I2C_IF_RXDATAV) {
+                obj->i2c.slave_reg = i2c->RXDATA;
+                i2c_slave_phase_start(obj, false);
+                i2c->CMD = I2C_CMD_ACK;
+            }
+            break;
+        case I2C_PHASE_SLAVE_RX:
+            if (pending & I2C_IF_RXDATAV) {
+                uint8_t data = i2c->RXDATA;
+                if (obj->i2c.use_dma) {
+                    /* DMA took care of all but the last byte */
+                    obj->i2c.use_dma = false;
+                    obj->i2c.seg_offset = obj->i2c.slave_length - 1;
+                }
+                /* Bytes beyond the end of the register are refused */
+                if (obj->i2c.seg_offset < obj->i2c.slave_length) {
+                    obj->i2c.slave_data[obj->i2c.seg_offset++] = data;
+                    i2c->CMD = I2C_CMD_ACK;
+                } else {
+                    i2c->CMD = I2C_CMD_NACK;
+                }
+            }
+            break;
+        case I2C_PHASE_SLAVE_TX:
+            if (pending & I2C_IF_NACK) {
+                /* The host has read all it wanted, wait for the stop or a repeated start */
+                i2c->IFC = I2C_IFC_NACK;
+                i2c_slave_phase_end(obj);
+            } else if (obj->i2c.use_dma) {
+                if (pending & I2C_IF_TXBL) {
+                    /* DMA is done, keep the host going until it NACKs */
+                    obj->i2c.slave_fill = true;
+                    i2c->TXDATA = I2C_SLAVE_FILL;
+                }
+            } else if (pending & I2C_IF_ACK) {
+                i2c->IFC = I2C_IFC_ACK;
+                if (obj->i2c.seg_offset < obj->i2c.slave_length) {
+                    i2c->TXDATA = obj->i2c.slave_data[obj->i2c.seg_offset++];
+                } else {
+                    obj->i2c.slave_fill = true;
+                    i2c->TXDATA = I2C_SLAVE_FILL;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+int i2c_slave_asynch(i2c_t *obj, int address, const i2c_slave_regfile_t *regfile, uint32_t handler, uint32_t event, DMAUsage hint)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+
+    MBED_ASSERT(regfile != NULL && regfile->access != NULL);
+
+    if (obj->i2c.slave || i2c_active(obj)) {
+        return I2C_ERROR_BUS_BUSY;
+    }
+
+    // Store event flags
+    obj->i2c.events = event;
+    obj->i2c.regfile = regfile;
+    obj->i2c.slave_reg = 0;
+    obj->i2c.phase = 0;
+
+    dma_init();
+    i2c_enable_dma(obj, hint);
+
+    /* Match all 7 address bits. The general call address is left enabled. */
+    i2c->SADDR = address & 0xFE;
+    i2c->SADDRMASK = 0xFE;
+    i2c->CTRL = (i2c->CTRL & ~I2C_CTRL_AUTOACK) | I2C_CTRL_SLAVE;
+#ifdef LDMA_PRESENT
+    obj->i2c.dma_ctrl = i2c->CTRL;
+#endif
+
+    i2c->CMD = I2C_CMD_CLEARPC | I2C_CMD_CLEARTX;
+    if (i2c->IF & I2C_IF_RXDATAV) {
+        (void) i2c->RXDATA;
+    }
+    i2c->IFC = _I2C_IFC_MASK;
+
+    /* Address recognition does not need the peripheral clock, so sleep is not blocked while idle */
+    obj->i2c.slave = true;
+    i2c->IEN = I2C_SLAVE_IEN;
+    i2c_enable_interrupt(obj, handler, true);
+
+    return 0;
+}
+
+void i2c_slave_abort_asynch(i2c_t *obj)
+{
+    if (!obj->i2c.slave) {
+        return;
+    }
+
+    i2c_enable_interrupt(obj, 0, false);
+    obj->i2c.i2c->IEN = 0;
+
+    i2c_slave_release(obj);
+    obj->i2c.i2c->CTRL &= ~(I2C_CTRL_SLAVE | I2C_CTRL_AUTOACK);
+    obj->i2c.slave = false;
+
+    /* The channel was held as long as the slave was enabled */
+    if (obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
+        dma_channel_free(obj->i2c.dmaOptions.dmaChannel);
+        obj->i2c.dmaOptions.dmaUsageState = DMA_USAGE_OPPORTUNISTIC;
+    }
+}
+
+#if DEVICE_INTERRUPTIN
+/******************************************
+* static void i2c_route_pins(i2c_t *obj, bool enable)
+*
+* Hand SDA and SCL to the peripheral, or back to GPIO. The pins stay in
+* WiredAndPullUp mode, so GPIO drives them through DOUT when released.
+******************************************/
+static void i2c_route_pins(i2c_t *obj, bool enable)
+{
+#ifdef I2C_ROUTE_SDAPEN
+    if (enable) {
+        obj->i2c.i2c->ROUTE |= I2C_ROUTE_SDAPEN | I2C_ROUTE_SCLPEN;
+    } else {
+        obj->i2c.i2c->ROUTE &= ~(I2C_ROUTE_SDAPEN | I2C_ROUTE_SCLPEN);
+    }
+#else
+    if (enable) {
+        obj->i2c.i2c->ROUTEPEN |= I2C_ROUTEPEN_SDAPEN | I2C_ROUTEPEN_SCLPEN;
+    } else {
+        obj->i2c.i2c->ROUTEPEN &= ~(I2C_ROUTEPEN_SDAPEN | I2C_ROUTEPEN_SCLPEN);
+    }
+#endif
+}
+
+static unsigned int i2c_pin_get(PinName pin)
+{
+    return GPIO_PinInGet((GPIO_Port_TypeDef)(pin >> 4 & 0xF), pin & 0xF);
+}
+
+static void i2c_pin_set(PinName pin, bool high)
+{
+    if (high) {
+        GPIO_PinOutSet((GPIO_Port_TypeDef)(pin >> 4 & 0xF), pin & 0xF);
+    } else {
+        GPIO_PinOutClear((GPIO_Port_TypeDef)(pin >> 4 & 0xF), pin & 0xF);
+    }
+}
+
+/* Half an SCL period of the recovery clock, which runs at standard mode speed */
+static void i2c_recover_delay(void)
+{
+    uint32_t start = us_ticker_read();
+
+    while ((us_ticker_read() - start) <= I2C_RECOVER_HALF_PERIOD_US);
+}
+
+/******************************************
+* static void i2c_recover_finish(i2c_t *obj, uint32_t event)
+*
+* Give the pins back to a freshly reset peripheral, with the same bus
+* frequency and mode, and report the outcome through the handler given
+* to i2c_recover_asynch(), if any.
+******************************************/
+static void i2c_recover_finish(i2c_t *obj, uint32_t event)
+{
+    I2C_TypeDef *i2c = obj->i2c.i2c;
+    uint32_t ctrl = i2c->CTRL;
+    uint32_t clkdiv = i2c->CLKDIV;
+
+    gpio_irq_hook(obj->i2c.scl, NULL, 0);
+    i2c_pin_set(obj->i2c.sda, true);
+    i2c_pin_set(obj->i2c.scl, true);
+
+    /* Routing is left alone by the reset */
+    I2C_Reset(i2c);
+    i2c->CLKDIV = clkdiv;
+    i2c->CTRL = ctrl;
+    if (i2c->STATE & I2C_STATE_BUSY) {
+        i2c->CMD = I2C_CMD_ABORT;
+    }
+    i2c_route_pins(obj, true);
+
+    if (event == I2C_EVENT_ERROR) {
+        obj->i2c.recover_failed++;
+    }
+    obj->i2c.phase = 0;
+    unblockSleepMode(EM1);
+
+    if (event && obj->i2c.recover_handler) {
+        obj->i2c.recover_event = event;
+        /* Go through the I2C handler, like a transfer completion would */
+        ((DMACallback)obj->i2c.recover_handler)();
+    }
+}
+
+/******************************************
+* static void i2c_recover_hook(uint32_t id, gpio_irq_event event)
+*
+* SCL edge during a bus recovery. Every edge is caused by the recovery
+* itself, so a slave stretching the clock simply delays the next one. A
+* rising edge ends a clock pulse: once the slave has released SDA, a stop
+* condition follows, otherwise another pulse, up to I2C_RECOVER_PULSES.
+******************************************/
+static void i2c_recover_hook(uint32_t id, gpio_irq_event event)
+{
+    i2c_t *obj = (i2c_t *)id;
+
+    i2c_recover_delay();
+
+    if (event == IRQ_FALL) {
+        if (obj->i2c.recover_stop) {
+            /* SDA goes low while SCL is low, to rise again while SCL is high */
+            i2c_pin_set(obj->i2c.sda, false);
+            i2c_recover_delay();
+        }
+        i2c_pin_set(obj->i2c.scl, true);
+        return;
+    }
+
+    if (obj->i2c.recover_stop) {
+        i2c_pin_set(obj->i2c.sda, true);
+        i2c_recover_finish(obj, I2C_EVENT_TRANSFER_COMPLETE);
+        return;
+    }
+
+    obj->i2c.recover_pulses++;
+    if (i2c_pin_get(obj->i2c.sda)) {
+        obj->i2c.recover_stop = true;
+    } else if (++obj->i2c.recover_step >= I2C_RECOVER_PULSES) {
+        i2c_recover_finish(obj, I2C_EVENT_ERROR);
+        return;
+    }
+    i2c_pin_set(obj->i2c.scl, false);
+}
+
+int i2c_recover_asynch(i2c_t *obj, uint32_t handler, uint32_t event)
+{
+    if (obj->i2c.slave || obj->i2c.phase) {
+        return I2C_ERROR_BUS_BUSY;
+    }
+
+    obj->i2c.events = event;
+    obj->i2c.recover_handler = handler;
+    obj->i2c.recover_event = 0;
+    obj->i2c.recover_step = 0;
+    obj->i2c.recover_count++;
+
+    /* Take the pins over with both lines released */
+    i2c_pin_set(obj->i2c.sda, true);
+    i2c_pin_set(obj->i2c.scl, true);
+    i2c_route_pins(obj, false);
+
+    obj->i2c.phase = I2C_PHASE_RECOVER;
+    blockSleepMode(EM1);
+
+    /* Nothing a master can do about a slave holding SCL, just reset the peripheral */
+    if (!i2c_pin_get(obj->i2c.scl)) {
+        i2c_recover_finish(obj, I2C_EVENT_ERROR);
+        return 0;
+    }
+
+    /* The first falling edge starts either the clock pulses or, if SDA is free already, the stop */
+    obj->i2c.recover_stop = i2c_pin_get(obj->i2c.sda) ? true : false;
+    gpio_irq_hook(obj->i2c.scl, i2c_recover_hook, (uint32_t)obj);
+    i2c_pin_set(obj->i2c.scl, false);
+
+    return 0;
+}
+
+void i2c_recovery_stats(i2c_t *obj, i2c_recovery_stats_t *stats)
+{
+    stats->recoveries = obj->i2c.recover_count;
+    stats->failures = obj->i2c.recover_failed;
+    stats->pulses = obj->i2c.recover_pulses;
+}
+#endif
 
 /** Start i2c asynchronous transfer.
  *  @param obj     The I2C object
@@ -379,12 +1466,10 @@ int block_and_wait_for_ack(I2C_TypeDef *i2c)
 void i2c_transfer_asynch(i2c_t *obj, void *tx, size_t tx_length, void *rx, size_t rx_length, uint32_t address, uint32_t stop, uint32_t handler, uint32_t event, DMAUsage hint)
 {
     (void)stop;
-    (void)hint;
 
     I2C_TransferReturn_TypeDef retval;
-    if(i2c_active(obj)) return;
+    if(obj->i2c.slave || i2c_active(obj)) return;
     if((tx_length == 0) && (rx_length == 0)) return;
-    // For now, we are assuming a solely interrupt-driven implementation.
 
     // Store transfer config
     obj->i2c.xfer.addr = address;
@@ -414,7 +1499,32 @@ void i2c_transfer_asynch(i2c_t *obj, void *tx, size_t tx_length, void *rx, size_
     // Store event flags
     obj->i2c.events = event;
 
-    // Enable interrupt
+    // Let DMA move the data if the hint allows and a channel is free. 10 bit addressing is left to emlib.
+    if(address <= 255) {
+        dma_init();
+        i2c_enable_dma(obj, hint);
+        if((obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_ALLOCATED) || (obj->i2c.dmaOptions.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED)) {
+            uint8_t count = 0;
+            if(tx_length > 0) {
+                obj->i2c.segments_local[count].data = (uint8_t *)tx;
+                obj->i2c.segments_local[count].length = (uint16_t) tx_length;
+                obj->i2c.segments_local[count].address = address;
+                obj->i2c.segments_local[count].flags = 0;
+                count++;
+            }
+            if(rx_length > 0) {
+                obj->i2c.segments_local[count].data = (uint8_t *)rx;
+                obj->i2c.segments_local[count].length = (uint16_t) rx_length;
+                obj->i2c.segments_local[count].address = address;
+                obj->i2c.segments_local[count].flags = I2C_SEGMENT_READ;
+                count++;
+            }
+            i2c_segments_start(obj, obj->i2c.segments_local, count, handler);
+            return;
+        }
+    }
+
+    // Otherwise, emlib moves the data byte by byte from the interrupt
     i2c_enable_interrupt(obj, handler, true);
 
     // Kick off the transfer
@@ -430,7 +1540,7 @@ void i2c_transfer_asynch(i2c_t *obj, void *tx, size_t tx_length, void *rx, size_
         i2c_enable_interrupt(obj, 0, false);
 
         // Block until free
-        while(i2c_active(obj));
+        i2c_wait_idle(obj);
     }
 }
 
@@ -440,8 +1550,19 @@ void i2c_transfer_asynch(i2c_t *obj, void *tx, size_t tx_length, void *rx, size_
  */
 uint32_t i2c_irq_handler_asynch(i2c_t *obj)
 {
-
-    // For now, we are assuming a solely interrupt-driven implementation.
+#if DEVICE_INTERRUPTIN
+    if (obj->i2c.recover_event) {
+        uint32_t event = obj->i2c.recover_event;
+        obj->i2c.recover_event = 0;
+        return event & obj->i2c.events;
+    }
+#endif
+    if (obj->i2c.slave) {
+        return i2c_slave_irq_handler(obj);
+    }
+    if (obj->i2c.phase) {
+        return i2c_segments_irq_handler(obj);
+    }
 
     I2C_TransferReturn_TypeDef status = I2C_Transfer(obj->i2c.i2c);
     switch(status) {
@@ -483,7 +1604,8 @@ uint32_t i2c_irq_handler_asynch(i2c_t *obj)
  */
 uint8_t i2c_active(i2c_t *obj)
 {
-    return (obj->i2c.i2c->STATE & I2C_STATE_BUSY);
+    /* The bus is briefly free between segments separated by a stop */
+    return (obj->i2c.phase != 0) || (obj->i2c.i2c->STATE & I2C_STATE_BUSY);
 }
 
 /** Abort ongoing asynchronous transaction.
@@ -491,6 +1613,20 @@ uint8_t i2c_active(i2c_t *obj)
  */
 void i2c_abort_asynch(i2c_t *obj)
 {
+    if (obj->i2c.slave) {
+        i2c_slave_abort_asynch(obj);
+        return;
+    }
+
+#if DEVICE_INTERRUPTIN
+    if (obj->i2c.phase == I2C_PHASE_RECOVER) {
+        // Give up on the recovery, without reporting it
+        obj->i2c.recover_handler = 0;
+        i2c_recover_finish(obj, 0);
+        return;
+    }
+#endif
+
     // Do not deactivate I2C twice
     if (!i2c_active(obj)) return;
 
@@ -500,10 +1636,22 @@ void i2c_abort_asynch(i2c_t *obj)
     // Abort
     obj->i2c.i2c->CMD = I2C_CMD_STOP | I2C_CMD_ABORT;
 
-    // Block until free
-    while(i2c_active(obj));
+    if (obj->i2c.phase) {
+        // Also stops DMA and releases sleep mode
+        i2c_segments_finish(obj, 0);
+    } else {
+        unblockSleepMode(EM1);
+    }
 
-    unblockSleepMode(EM1);
+    // Block until free, for a bounded time
+    i2c_wait_idle(obj);
+
+#if DEVICE_INTERRUPTIN
+    // A slave still holding SDA would block the next transfer, so free the bus in the background
+    if (!i2c_pin_get(obj->i2c.sda)) {
+        i2c_recover_asynch(obj, 0, 0);
+    }
+#endif
 }
 
 #endif //DEVICE_I2C ASYNCH
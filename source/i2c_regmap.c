@@ -0,0 +1,312 @@
+/***************************************************************************//**
+ * @file i2c_regmap.c
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "mbed-hal-efm32/device.h"
+#if DEVICE_I2C_ASYNCH
+
+#include <string.h>
+
+#include "mbed-drivers/mbed_assert.h"
+
+#include "mbed-hal-efm32/i2c_regmap.h"
+#include "mbed-hal-efm32/sleepmodes.h"
+
+/* Longest wait for a transfer, in microseconds */
+#define I2C_REGMAP_TIMEOUT      100000
+
+#define I2C_REGMAP_EVENTS       (I2C_EVENT_ERROR | I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_COMPLETE | I2C_EVENT_TRANSFER_EARLY_NACK)
+
+/* Bus bytes of a register accessed on its own: address, register and data, plus the address again for a read */
+#define I2C_REGMAP_WRITE_COST   3
+#define I2C_REGMAP_READ_COST    4
+
+/* The I2C handler is called without arguments. Transfers are waited for, so only one is in flight. */
+static i2c_regmap_t *i2c_regmap_current = NULL;
+
+static bool i2c_regmap_test(const uint8_t *bits, uint32_t reg)
+{
+    return (bits[reg >> 3] & (1 << (reg & 7))) ? true : false;
+}
+
+static void i2c_regmap_mark(uint8_t *bits, uint32_t reg, bool set)
+{
+    if (set) {
+        bits[reg >> 3] |= (1 << (reg & 7));
+    } else {
+        bits[reg >> 3] &= ~(1 << (reg & 7));
+    }
+}
+
+/* Completion of a segment list */
+static void i2c_regmap_irq_handler(void)
+{
+    i2c_regmap_t *map = i2c_regmap_current;
+    uint32_t event = i2c_irq_handler_asynch(map->i2c);
+
+    if (event) {
+        map->event = event;
+        map->busy = false;
+    }
+}
+
+/******************************************
+* static int i2c_regmap_transfer(i2c_regmap_t *map, uint8_t count)
+*
+* Run the first count entries of map->segments, and sleep until they are
+* done or I2C_REGMAP_TIMEOUT has passed. A transfer that timed out is
+* aborted, which also frees the bus if a slave holds on to it.
+******************************************/
+static int i2c_regmap_transfer(i2c_regmap_t *map, uint8_t count)
+{
+    int ret;
+
+    i2c_regmap_current = map;
+    map->event = 0;
+    map->busy = true;
+
+    ret = i2c_transfer_list_asynch(map->i2c, map->segments, count, (uint32_t)i2c_regmap_irq_handler, I2C_REGMAP_EVENTS, DMA_USAGE_OPPORTUNISTIC);
+    if (ret != 0) {
+        map->busy = false;
+        return ret;
+    }
+
+    if (sleep_while(&(map->busy), 1, 1, I2C_REGMAP_TIMEOUT)) {
+        i2c_abort_asynch(map->i2c);
+        map->busy = false;
+        return I2C_REGMAP_ERROR_TIMEOUT;
+    }
+    if (map->event & I2C_EVENT_ERROR_NO_SLAVE) {
+        return I2C_ERROR_NO_SLAVE;
+    }
+    if (map->event & (I2C_EVENT_ERROR | I2C_EVENT_TRANSFER_EARLY_NACK)) {
+        return I2C_REGMAP_ERROR_TRANSFER;
+    }
+    return 0;
+}
+
+/* Add a run of registers to map->segments: the register byte, then the data */
+static uint8_t i2c_regmap_add_run(i2c_regmap_t *map, uint8_t runs, uint32_t reg, uint32_t length, uint8_t flags)
+{
+    i2c_segment_t *segment = &(map->segments[2 * runs]);
+
+    map->regs[runs] = reg;
+
+    segment[0].data = &(map->regs[runs]);
+    segment[0].length = 1;
+    segment[0].address = map->address;
+    segment[0].flags = 0;
+
+    /* Each run is a transaction of its own */
+    segment[1].data = &(map->values[reg]);
+    segment[1].length = length;
+    segment[1].address = map->address;
+    segment[1].flags = flags | I2C_SEGMENT_STOP;
+
+    return runs + 1;
+}
+
+/******************************************
+* static int i2c_regmap_flush(i2c_regmap_t *map, uint32_t first, uint32_t end)
+*
+* Write the pending registers in [first, end) to the device, in one burst
+* for each run of consecutive ones, up to I2C_REGMAP_RUNS_MAX runs per
+* transfer.
+******************************************/
+static int i2c_regmap_flush(i2c_regmap_t *map, uint32_t first, uint32_t end)
+{
+    uint32_t reg = first;
+    uint32_t start, i;
+    uint8_t runs, run;
+    int ret;
+
+    while (reg < end) {
+        runs = 0;
+        while ((reg < end) && (runs < I2C_REGMAP_RUNS_MAX)) {
+            if (!i2c_regmap_test(map->dirty, reg)) {
+                reg++;
+                continue;
+            }
+            start = reg;
+            while ((reg < end) && i2c_regmap_test(map->dirty, reg)) {
+                reg++;
+            }
+            /* Data continues the register byte, without a repeated start */
+            runs = i2c_regmap_add_run(map, runs, start, reg - start, I2C_SEGMENT_NOSTART);
+        }
+
+        if (runs == 0) {
+            break;
+        }
+        ret = i2c_regmap_transfer(map, 2 * runs);
+        if (ret != 0) {
+            return ret;
+        }
+
+        for (run = 0; run < runs; run++) {
+            for (i = 0; i < map->segments[2 * run + 1].length; i++) {
+                i2c_regmap_mark(map->dirty, map->regs[run] + i, false);
+            }
+            /* One transaction of length + 2 bytes, rather than one of 3 per register */
+            map->bytes_saved += (I2C_REGMAP_WRITE_COST - 1) * (map->segments[2 * run + 1].length - 1);
+        }
+    }
+
+    return 0;
+}
+
+void i2c_regmap_init(i2c_regmap_t *map, i2c_t *i2c, uint8_t address)
+{
+    map->i2c = i2c;
+    map->address = address & 0xFE;
+    map->busy = false;
+    map->event = 0;
+    map->hits = 0;
+    map->misses = 0;
+    map->bytes_saved = 0;
+    memset(map->valid, 0, sizeof(map->valid));
+    memset(map->dirty, 0, sizeof(map->dirty));
+    memset(map->uncached, 0, sizeof(map->uncached));
+}
+
+void i2c_regmap_set_volatile(i2c_regmap_t *map, uint8_t reg, uint16_t count)
+{
+    uint32_t i;
+
+    MBED_ASSERT((uint32_t)reg + count <= I2C_REGMAP_SIZE);
+
+    for (i = reg; i < (uint32_t)reg + count; i++) {
+        i2c_regmap_mark(map->uncached, i, true);
+        i2c_regmap_mark(map->valid, i, false);
+    }
+}
+
+int i2c_regmap_read(i2c_regmap_t *map, uint8_t reg, uint8_t *buffer, uint16_t length)
+{
+    uint32_t end = (uint32_t)reg + length;
+    uint32_t i = reg;
+    uint32_t start, j;
+    uint8_t runs, run;
+    int ret;
+
+    MBED_ASSERT(end <= I2C_REGMAP_SIZE);
+
+    /* Cached values are already in place, fetch the others next to them */
+    while (i < end) {
+        runs = 0;
+        while ((i < end) && (runs < I2C_REGMAP_RUNS_MAX)) {
+            if (i2c_regmap_test(map->valid, i)) {
+                map->hits++;
+                map->bytes_saved += I2C_REGMAP_READ_COST;
+                i++;
+                continue;
+            }
+            start = i;
+            while ((i < end) && !i2c_regmap_test(map->valid, i)) {
+                i++;
+            }
+            map->misses += i - start;
+            runs = i2c_regmap_add_run(map, runs, start, i - start, I2C_SEGMENT_READ);
+        }
+
+        if (runs == 0) {
+            break;
+        }
+        ret = i2c_regmap_transfer(map, 2 * runs);
+        if (ret != 0) {
+            return ret;
+        }
+
+        for (run = 0; run < runs; run++) {
+            for (j = 0; j < map->segments[2 * run + 1].length; j++) {
+                uint32_t r = map->regs[run] + j;
+                if (!i2c_regmap_test(map->uncached, r)) {
+                    i2c_regmap_mark(map->valid, r, true);
+                }
+            }
+            /* One transaction of length + 3 bytes, rather than one of 4 per register */
+            map->bytes_saved += (I2C_REGMAP_READ_COST - 1) * (map->segments[2 * run + 1].length - 1);
+        }
+    }
+
+    memcpy(buffer, &(map->values[reg]), length);
+    return 0;
+}
+
+int i2c_regmap_write(i2c_regmap_t *map, uint8_t reg, const uint8_t *buffer, uint16_t length)
+{
+    uint32_t end = (uint32_t)reg + length;
+    uint32_t i;
+    bool now = false;
+
+    MBED_ASSERT(end <= I2C_REGMAP_SIZE);
+
+    for (i = reg; i < end; i++) {
+        if (i2c_regmap_test(map->uncached, i)) {
+            now = true;
+        } else {
+            /* A value still pending is replaced before it ever reaches the bus */
+            if (i2c_regmap_test(map->dirty, i)) {
+                map->bytes_saved += I2C_REGMAP_WRITE_COST;
+            }
+            i2c_regmap_mark(map->valid, i, true);
+        }
+        i2c_regmap_mark(map->dirty, i, true);
+        map->values[i] = buffer[i - reg];
+    }
+
+    if (now) {
+        return i2c_regmap_flush(map, reg, end);
+    }
+    return 0;
+}
+
+int i2c_regmap_update_bits(i2c_regmap_t *map, uint8_t reg, uint8_t mask, uint8_t value)
+{
+    uint8_t old, updated;
+    int ret;
+
+    ret = i2c_regmap_read(map, reg, &old, 1);
+    if (ret != 0) {
+        return ret;
+    }
+
+    updated = (old & ~mask) | (value & mask);
+    if ((updated == old) && !i2c_regmap_test(map->uncached, reg)) {
+        map->bytes_saved += I2C_REGMAP_WRITE_COST;
+        return 0;
+    }
+    return i2c_regmap_write(map, reg, &updated, 1);
+}
+
+int i2c_regmap_sync(i2c_regmap_t *map)
+{
+    return i2c_regmap_flush(map, 0, I2C_REGMAP_SIZE);
+}
+
+void i2c_regmap_invalidate(i2c_regmap_t *map)
+{
+    memset(map->valid, 0, sizeof(map->valid));
+    memset(map->dirty, 0, sizeof(map->dirty));
+}
+
+#endif
@@ -40,18 +40,28 @@
 #include "mbed-hal-efm32/PeripheralPins.h"
 #include "mbed-hal-efm32/PeripheralNames.h"
 #include "mbed-hal-efm32/dma_api_HAL.h"
+#include "mbed-hal-efm32/serial_api_HAL.h"
 #include "mbed-hal-efm32/sleepmodes.h"
+#include "mbed-hal-efm32/usart_baud.h"
 
 #include "em_usart.h"
 #include "em_leuart.h"
 #include "em_cmu.h"
 #include "em_dma.h"
+#include "em_int.h"
 
 #include "uvisor-lib/uvisor-lib.h"
 
 #define SERIAL_LEAST_ACTIVE_SLEEPMODE EM1
 #define SERIAL_LEAST_ACTIVE_SLEEPMODE_LEUART EM2
 
+/** Maximum number of frames a single DMA descriptor can move */
+#ifdef LDMA_PRESENT
+#define SERIAL_DMA_MAX_TRANSFER ((_LDMA_CH_CTRL_XFERCNT_MASK >> _LDMA_CH_CTRL_XFERCNT_SHIFT) + 1)
+#else
+#define SERIAL_DMA_MAX_TRANSFER ((_DMA_CTRL_N_MINUS_1_MASK >> _DMA_CTRL_N_MINUS_1_SHIFT) + 1)
+#endif
+
 /** Validation of LEUART register block pointer reference
  *  for assert statements. */
 #if !defined(LEUART_COUNT)
@@ -83,11 +93,26 @@ static IRQn_Type serial_get_rx_irq_index(serial_t *obj);
 static IRQn_Type serial_get_tx_irq_index(serial_t *obj);
 static CMU_Clock_TypeDef serial_get_clock(serial_t *obj);
 static void serial_dmaSetupChannel(serial_t *obj, bool tx_nrx);
+static void serial_dmaActivateCircular(serial_t *obj);
+static size_t serial_dmaCircularIndex(serial_t *obj);
+static uint32_t serial_rx_circular_refill(serial_t *obj, uint8_t slot);
+static int serial_rx_circular_start(serial_t *obj, uint32_t handler, uint32_t event, uint8_t idle_bits);
+#if SERIAL_TX_SEGMENTS_MAX > 0
+static void serial_dmaActivateSegments(serial_t *obj, const serial_tx_segment_t *segments, uint8_t count);
+static void serial_tx_queue_txc(serial_t *obj, bool arm);
+#endif
+#if SERIAL_TX_QUEUE_SIZE > 0
+static void serial_tx_queue_next(serial_t *obj);
+#endif
 static void serial_rx_abort_asynch_intern(serial_t *obj, int unblock_sleep);
 static void serial_tx_abort_asynch_intern(serial_t *obj, int unblock_sleep);
 static void serial_block_sleep(serial_t *obj);
 static void serial_unblock_sleep(serial_t *obj);
+static bool serial_leuart_in_em2(serial_t *obj);
+static void serial_leuart_dma_em2(serial_t *obj, bool tx_nrx, bool enable);
 static void serial_leuart_baud(serial_t *obj, int baudrate);
+static bool serial_rts_enabled(serial_t *obj);
+static uint32_t serial_usart_rx_start_cmd(serial_t *obj);
 
 /* ISRs for RX and TX events */
 #ifdef UART0
@@ -418,6 +443,10 @@ void serial_preinit(serial_t *obj, PinName tx, PinName rx)
     //TODO: replace all usages with AF_USARTx_TX_PORT(location) macro to save 8 bytes from struct
     obj->serial.rx_pin = rx;
     obj->serial.tx_pin = tx;
+#if DEVICE_SERIAL_FC
+    obj->serial.rts_pin = NC;
+    obj->serial.cts_pin = NC;
+#endif
 
     /* Select interrupt */
     switch ((uint32_t)obj->serial.periph.uart) {
@@ -488,6 +517,14 @@ static void serial_enable_pins(serial_t *obj, uint8_t enable)
         if(obj->serial.tx_pin != NC) {
             pin_mode(obj->serial.tx_pin, Disabled);
         }
+#if DEVICE_SERIAL_FC
+        if(obj->serial.rts_pin != NC) {
+            pin_mode(obj->serial.rts_pin, Disabled);
+        }
+        if(obj->serial.cts_pin != NC) {
+            pin_mode(obj->serial.cts_pin, Disabled);
+        }
+#endif
     }
 }
 
@@ -556,7 +593,6 @@ void serial_init(serial_t *obj, PinName tx, PinName rx)
         }
 #endif
         obj->serial.periph.leuart->IFC = LEUART_IFC_TXC;
-        obj->serial.periph.leuart->CTRL |= LEUART_CTRL_RXDMAWU | LEUART_CTRL_TXDMAWU;
     } else {
 #ifdef _USART_ROUTE_LOCATION_SHIFT
         obj->serial.periph.uart->ROUTE = (obj->serial.location << _USART_ROUTE_LOCATION_SHIFT);
@@ -599,6 +635,17 @@ void serial_init(serial_t *obj, PinName tx, PinName rx)
     obj->serial.dmaOptionsRX.dmaChannel = -1;
     obj->serial.dmaOptionsRX.dmaUsageState = DMA_USAGE_OPPORTUNISTIC;
 
+    obj->serial.rx_circ_active = false;
+    obj->serial.rx_circ_handler = 0;
+    obj->serial.rx_pool_active = false;
+
+#if SERIAL_TX_SEGMENTS_MAX > 0
+    obj->serial.tx_queue_active = false;
+#endif
+#if SERIAL_TX_QUEUE_SIZE > 0
+    obj->serial.tx_queue_count = 0;
+    obj->serial.tx_queue_done = 0;
+#endif
 }
 
 void serial_free(serial_t *obj)
@@ -637,7 +684,7 @@ void serial_baud(serial_t *obj, int baudrate)
     if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
         serial_leuart_baud(obj, baudrate);
     } else {
-        USART_BaudrateAsyncSet(obj->serial.periph.uart, REFERENCE_FREQUENCY, (uint32_t)baudrate, usartOVS16);
+        usart_baud_async_set(obj->serial.periph.uart, REFERENCE_FREQUENCY, (uint32_t)baudrate);
     }
 }
 
@@ -717,6 +764,30 @@ static void serial_leuart_baud(serial_t *obj, int baudrate)
 #endif
 }
 
+#if DEVICE_SERIAL_FC && defined(_USART_ROUTELOC1_MASK)
+/**
+ * Route RTS/CTS to the pins recorded by serial_set_flow_control(). Also used
+ * to restore them after the USART has been re-initialized.
+ */
+static void serial_flow_control_route(serial_t *obj)
+{
+    USART_TypeDef *uart = obj->serial.periph.uart;
+
+    uart->CTRLX &= ~USART_CTRLX_CTSEN;
+    uart->ROUTEPEN &= ~(USART_ROUTEPEN_RTSPEN | USART_ROUTEPEN_CTSPEN);
+
+    if(obj->serial.rts_pin != NC) {
+        uart->ROUTELOC1 = (uart->ROUTELOC1 & (~_USART_ROUTELOC1_RTSLOC_MASK)) | (pin_location(obj->serial.rts_pin, PinMap_UART_RTS) << _USART_ROUTELOC1_RTSLOC_SHIFT);
+        uart->ROUTEPEN |= USART_ROUTEPEN_RTSPEN;
+    }
+    if(obj->serial.cts_pin != NC) {
+        uart->ROUTELOC1 = (uart->ROUTELOC1 & (~_USART_ROUTELOC1_CTSLOC_MASK)) | (pin_location(obj->serial.cts_pin, PinMap_UART_CTS) << _USART_ROUTELOC1_CTSLOC_SHIFT);
+        uart->ROUTEPEN |= USART_ROUTEPEN_CTSPEN;
+        uart->CTRLX |= USART_CTRLX_CTSEN;
+    }
+}
+#endif
+
 /**
  * Set UART format by re-initializing the peripheral.
  */
@@ -789,6 +860,8 @@ void serial_format(serial_t *obj, int data_bits, SerialParity parity, int stop_b
         /* Save the serial state */
         uint8_t     was_enabled = USART_StatusGet(obj->serial.periph.uart) & (USART_STATUS_TXENS | USART_STATUS_RXENS);
         uint32_t    enabled_interrupts = obj->serial.periph.uart->IEN;
+        uint32_t    ovs = obj->serial.periph.uart->CTRL & _USART_CTRL_OVS_MASK;
+        uint32_t    clkdiv = obj->serial.periph.uart->CLKDIV;
 
 
         USART_InitAsync_TypeDef init = USART_INITASYNC_DEFAULT;
@@ -796,10 +869,10 @@ void serial_format(serial_t *obj, int data_bits, SerialParity parity, int stop_b
         /* We support 4 to 8 data bits */
         MBED_ASSERT(data_bits >= 4 && data_bits <= 8);
 
-        /* Re-init the UART */
-        init.enable = (was_enabled == 0 ? usartDisable : usartEnable);
+        /* Re-init the UART, keeping the baud rate settings found by the solver */
+        init.enable = usartDisable;
         init.baudrate = USART_BaudrateGet(obj->serial.periph.uart);
-        init.oversampling = usartOVS16;
+        init.oversampling = (USART_OVS_TypeDef)ovs;
         init.databits = (USART_Databits_TypeDef)((data_bits - 3) << _USART_FRAME_DATABITS_SHIFT);
         if (stop_bits == 2) {
             init.stopbits = usartStopbits2;
@@ -821,6 +894,8 @@ void serial_format(serial_t *obj, int data_bits, SerialParity parity, int stop_b
         }
 
         USART_InitAsync(obj->serial.periph.uart, &init);
+        obj->serial.periph.uart->CLKDIV = clkdiv;
+        USART_Enable(obj->serial.periph.uart, (was_enabled == 0 ? usartDisable : usartEnable));
 
         /* Re-enable pins for UART at correct location */
 #ifdef _USART_ROUTE_LOCATION_SHIFT
@@ -845,6 +920,10 @@ void serial_format(serial_t *obj, int data_bits, SerialParity parity, int stop_b
             obj->serial.periph.uart->ROUTEPEN  = (obj->serial.periph.uart->ROUTEPEN & (~_USART_ROUTEPEN_RXPEN_MASK));
         }
 #endif
+#if DEVICE_SERIAL_FC && defined(_USART_ROUTELOC1_MASK)
+        /* The re-init dropped RTS/CTS, the pins kept their state meanwhile */
+        serial_flow_control_route(obj);
+#endif
 
         /* Re-enable interrupts */
         if(was_enabled != 0) {
@@ -1038,6 +1117,89 @@ void serial_irq_set(serial_t *obj, SerialIrq irq, uint32_t enable)
     }
 }
 
+#if DEVICE_SERIAL_FC
+/**
+ * Set hardware flow control. Only USARTs on Series 1 (with ROUTELOC1) have
+ * RTS/CTS hardware; the USART then gates TX on CTS and drives RTS from the
+ * state of its RX buffer, so both the DMA and interrupt paths are covered.
+ */
+void serial_set_flow_control(serial_t *obj, FlowControl type, PinName rxflow, PinName txflow)
+{
+#if defined(_USART_ROUTELOC1_MASK)
+    USART_TypeDef *uart = obj->serial.periph.uart;
+
+    if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
+        /* No flow control hardware on LEUART */
+        MBED_ASSERT(type == FlowControlNone);
+        return;
+    }
+
+    /* Release whatever was routed before */
+    uart->CTRLX &= ~USART_CTRLX_CTSEN;
+    uart->ROUTEPEN &= ~(USART_ROUTEPEN_RTSPEN | USART_ROUTEPEN_CTSPEN);
+    if(obj->serial.rts_pin != NC) {
+        pin_mode(obj->serial.rts_pin, Disabled);
+        obj->serial.rts_pin = NC;
+    }
+    if(obj->serial.cts_pin != NC) {
+        pin_mode(obj->serial.cts_pin, Disabled);
+        obj->serial.cts_pin = NC;
+    }
+
+    if((type == FlowControlRTS) || (type == FlowControlRTSCTS)) {
+        MBED_ASSERT((USART_TypeDef *)pinmap_peripheral(rxflow, PinMap_UART_RTS) == uart);
+
+        /* Set DOUT first so the peer is held off until the USART takes over */
+        GPIO_PinOutSet((GPIO_Port_TypeDef)(rxflow >> 4 & 0xF), rxflow & 0xF);
+        pin_mode(rxflow, PushPull);
+        obj->serial.rts_pin = rxflow;
+    }
+
+    if((type == FlowControlCTS) || (type == FlowControlRTSCTS)) {
+        MBED_ASSERT((USART_TypeDef *)pinmap_peripheral(txflow, PinMap_UART_CTS) == uart);
+
+        pin_mode(txflow, Input);
+        obj->serial.cts_pin = txflow;
+    }
+
+    serial_flow_control_route(obj);
+#else
+    /* Series 0 USARTs and LEUARTs have no flow control hardware */
+    (void)obj;
+    (void)rxflow;
+    (void)txflow;
+    MBED_ASSERT(type == FlowControlNone);
+#endif
+}
+#endif
+
+/**
+ * Check whether the USART drives RTS in hardware
+ */
+static bool serial_rts_enabled(serial_t *obj)
+{
+#if DEVICE_SERIAL_FC && defined(_USART_ROUTELOC1_MASK)
+    if(LEUART_REF_VALID(obj->serial.periph.leuart)) return false;
+    return (obj->serial.periph.uart->ROUTEPEN & USART_ROUTEPEN_RTSPEN) ? true : false;
+#else
+    (void)obj;
+    return false;
+#endif
+}
+
+/**
+ * USART command to start the receiver. With RTS flow control the receiver is
+ * left running between transfers and RTS holds the peer off, so what's in the
+ * RX buffer is valid data and must not be cleared.
+ */
+static uint32_t serial_usart_rx_start_cmd(serial_t *obj)
+{
+    if(serial_rts_enabled(obj)) {
+        return USART_CMD_RXEN;
+    }
+    return USART_CMD_RXEN | USART_CMD_CLEARRX;
+}
+
 /******************************************************************************
  *                               READ/WRITE                                   *
  ******************************************************************************/
@@ -1158,6 +1320,40 @@ static void serial_dmaTransferComplete(unsigned int channel, bool primary, void
     }
 }
 
+#if SERIAL_TX_SEGMENTS_MAX > 0
+/******************************************
+* static void serial_dmaTxQueueComplete(uint channel, bool primary, void* user)
+*
+* Callback function which gets called when all segments of a queued TX
+* request have been handed to the peripheral. The user pointer is the
+* serial object.
+******************************************/
+static void serial_dmaTxQueueComplete(unsigned int channel, bool primary, void *user)
+{
+    serial_t *obj = (serial_t *)user;
+    (void)primary;
+
+#if SERIAL_TX_QUEUE_SIZE > 0
+    if (obj->serial.tx_queue_count > 0) {
+        /* Chain the next request while the last bytes are still being shifted out.
+         * TXC stays masked, the line may well go idle in between. */
+        serial_tx_queue_next(obj);
+        obj->serial.tx_queue_done++;
+
+        /* Handler should be a thunk to CPP land */
+        if (obj->serial.tx_queue_handler != 0) {
+            ((DMACallback)obj->serial.tx_queue_handler)();
+        }
+        return;
+    }
+#endif
+
+    /* Nothing left, completion is reported by TXC once the line is idle */
+    serial_dma_irq_fired[channel] = true;
+    serial_tx_queue_txc(obj, true);
+}
+#endif
+
 #ifndef LDMA_PRESENT
 
 /******************************************
@@ -1390,7 +1586,7 @@ static void serial_dmaActivate(serial_t *obj, void* cb, void* buffer, int length
             DMA_ActivateBasic(obj->serial.dmaOptionsRX.dmaChannel, true, false, buffer, (void*) &(obj->serial.periph.leuart->RXDATA), length - 1);
         } else {
             // Activate RX and clear RX buffer
-            obj->serial.periph.uart->CMD = USART_CMD_RXEN | USART_CMD_CLEARRX;
+            obj->serial.periph.uart->CMD = serial_usart_rx_start_cmd(obj);
 
             // Kick off RX DMA
             DMA_ActivateBasic(obj->serial.dmaOptionsRX.dmaChannel, true, false, buffer, (void*) &(obj->serial.periph.uart->RXDATA), length - 1);
@@ -1398,6 +1594,133 @@ static void serial_dmaActivate(serial_t *obj, void* cb, void* buffer, int length
     }
 }
 
+#if SERIAL_TX_SEGMENTS_MAX > 0
+/******************************************
+* static void serial_dmaActivateSegments(serial_t *obj, const serial_tx_segment_t *segments, uint8_t count)
+*
+* Kicks off a peripheral scatter-gather TX cycle, one alternate descriptor
+* per segment. The transmitter must already be enabled.
+******************************************/
+static void serial_dmaActivateSegments(serial_t *obj, const serial_tx_segment_t *segments, uint8_t count)
+{
+    DMA_CfgDescrSGAlt_TypeDef descrConfig;
+    uint8_t i;
+
+    // Set DMA callback
+    obj->serial.dmaOptionsTX.dmaCallback.cbFunc = serial_dmaTxQueueComplete;
+    obj->serial.dmaOptionsTX.dmaCallback.userPtr = obj;
+
+    // Set up configuration structure, shared by all segments
+    descrConfig.dstInc = dmaDataIncNone;
+    descrConfig.srcInc = dmaDataInc1;
+    descrConfig.size = dmaDataSize1;
+    descrConfig.arbRate = dmaArbitrate1;
+    descrConfig.hprot = 0;
+    descrConfig.peripheral = true;
+
+    if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
+        descrConfig.dst = (void*) &(obj->serial.periph.leuart->TXDATA);
+    } else {
+        descrConfig.dst = (void*) &(obj->serial.periph.uart->TXDATA);
+    }
+
+    for(i = 0; i < count; i++) {
+        descrConfig.src = (void*) segments[i].buffer;
+        descrConfig.nMinus1 = segments[i].length - 1;
+        DMA_CfgDescrScatterGather(obj->serial.tx_sg_desc, i, &descrConfig);
+    }
+
+    // Kick off TX DMA
+    DMA_ActivateScatterGather(obj->serial.dmaOptionsTX.dmaChannel, false, obj->serial.tx_sg_desc, count);
+}
+#endif
+
+/******************************************
+* static void serial_dmaCircularComplete(uint channel, bool primary, void* user)
+*
+* Callback function which gets called when one half of a circular RX buffer
+* has been filled. The user pointer is the serial object.
+******************************************/
+static void serial_dmaCircularComplete(unsigned int channel, bool primary, void *user)
+{
+    serial_t *obj = (serial_t *)user;
+    uint8_t slot = primary ? 0 : 1;
+
+    obj->serial.rx_circ_events |= serial_rx_circular_refill(obj, slot);
+
+    /* Re-arm the finished descriptor while the controller fills the other half */
+    DMA_RefreshPingPong(channel, primary, false, obj->serial.rx_circ_buffer[slot], NULL, obj->serial.rx_circ_length[slot] - 1, false);
+
+    /* Handler should be a thunk to CPP land */
+    if (obj->serial.rx_circ_handler != 0) {
+        ((DMACallback)obj->serial.rx_circ_handler)();
+    }
+}
+
+/******************************************
+* static void serial_dmaActivateCircular(serial_t *obj)
+*
+* Starts a ping-pong RX cycle over the two halves of the circular buffer.
+******************************************/
+static void serial_dmaActivateCircular(serial_t *obj)
+{
+    DMA_CfgDescr_TypeDef channelConfig;
+    void *source_addr;
+
+    // Set DMA callback
+    obj->serial.dmaOptionsRX.dmaCallback.cbFunc = serial_dmaCircularComplete;
+    obj->serial.dmaOptionsRX.dmaCallback.userPtr = obj;
+
+    // Set up configuration structure, for both primary and alternate descriptor
+    channelConfig.dstInc = dmaDataInc1;
+    channelConfig.srcInc = dmaDataIncNone;
+    channelConfig.size = dmaDataSize1;
+    channelConfig.arbRate = dmaArbitrate1;
+    channelConfig.hprot = 0;
+
+    DMA_CfgDescr(obj->serial.dmaOptionsRX.dmaChannel, true, &channelConfig);
+    DMA_CfgDescr(obj->serial.dmaOptionsRX.dmaChannel, false, &channelConfig);
+
+    if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
+        // Activate RX and clear RX buffer
+        obj->serial.periph.leuart->CMD = LEUART_CMD_CLEARRX;
+        obj->serial.periph.leuart->CMD = LEUART_CMD_RXEN;
+        while(obj->serial.periph.leuart->SYNCBUSY & LEUART_SYNCBUSY_CMD);
+        source_addr = (void*) &(obj->serial.periph.leuart->RXDATA);
+    } else {
+        // Activate RX and clear RX buffer
+        obj->serial.periph.uart->CMD = serial_usart_rx_start_cmd(obj);
+        source_addr = (void*) &(obj->serial.periph.uart->RXDATA);
+    }
+
+    // Kick off RX DMA
+    DMA_ActivatePingPong(obj->serial.dmaOptionsRX.dmaChannel, false,
+                         obj->serial.rx_circ_buffer[0], source_addr, obj->serial.rx_circ_length[0] - 1,
+                         obj->serial.rx_circ_buffer[1], source_addr, obj->serial.rx_circ_length[1] - 1);
+}
+
+/******************************************
+* static size_t serial_dmaCircularIndex(serial_t *obj)
+*
+* Derives the write index from whichever ping-pong descriptor is in use.
+******************************************/
+static size_t serial_dmaCircularIndex(serial_t *obj)
+{
+    int ch = obj->serial.dmaOptionsRX.dmaChannel;
+    uint8_t slot = (DMA->CHALTS & (1 << ch)) ? 1 : 0;
+    DMA_DESCRIPTOR_TypeDef *descr = ((DMA_DESCRIPTOR_TypeDef *)(slot ? DMA->ALTCTRLBASE : DMA->CTRLBASE)) + ch;
+    uint32_t ctrl = descr->CTRL;
+    uint32_t remaining = 0;
+
+    // A descriptor that has run to completion is marked invalid
+    if (ctrl & _DMA_CTRL_CYCLE_CTRL_MASK) {
+        remaining = ((ctrl & _DMA_CTRL_N_MINUS_1_MASK) >> _DMA_CTRL_N_MINUS_1_SHIFT) + 1;
+    }
+
+    return ((slot ? obj->serial.rx_circ_length[0] : 0) + obj->serial.rx_circ_length[slot] - remaining)
+           % obj->rx_buff.length;
+}
+
 #endif
 
 
@@ -1471,14 +1794,14 @@ static void serial_dmaActivate(serial_t *obj, void* cb, void* buffer, int length
             case USART_0:
                 dma_periph = ldmaPeripheralSignal_USART0_RXDATAV;
                 source_addr = &USART0->RXDATA;
-                obj->serial.periph.uart->CMD = USART_CMD_RXEN | USART_CMD_CLEARRX;
+                obj->serial.periph.uart->CMD = serial_usart_rx_start_cmd(obj);
                 break;
 #endif
 #ifdef USART1
             case USART_1:
                 dma_periph = ldmaPeripheralSignal_USART1_RXDATAV;
                 source_addr = &USART1->RXDATA;
-                obj->serial.periph.uart->CMD = USART_CMD_RXEN | USART_CMD_CLEARRX;
+                obj->serial.periph.uart->CMD = serial_usart_rx_start_cmd(obj);
                 break;
 #endif
 #ifdef LEUART0
@@ -1502,6 +1825,161 @@ static void serial_dmaActivate(serial_t *obj, void* cb, void* buffer, int length
     }
 }
 
+#if SERIAL_TX_SEGMENTS_MAX > 0
+/******************************************
+* static void serial_dmaActivateSegments(serial_t *obj, const serial_tx_segment_t *segments, uint8_t count)
+*
+* Kicks off a linked list of TX descriptors, one per segment. The
+* transmitter must already be enabled.
+******************************************/
+static void serial_dmaActivateSegments(serial_t *obj, const serial_tx_segment_t *segments, uint8_t count)
+{
+    LDMA_PeripheralSignal_t dma_periph;
+    volatile void *target_addr;
+    uint8_t i;
+
+    switch((uint32_t)(obj->serial.periph.uart)) {
+#ifdef USART0
+        case USART_0:
+            dma_periph = ldmaPeripheralSignal_USART0_TXBL;
+            target_addr = &USART0->TXDATA;
+            break;
+#endif
+#ifdef USART1
+        case USART_1:
+            dma_periph = ldmaPeripheralSignal_USART1_TXBL;
+            target_addr = &USART1->TXDATA;
+            break;
+#endif
+#ifdef LEUART0
+        case LEUART_0:
+            dma_periph = ldmaPeripheralSignal_LEUART0_TXBL;
+            target_addr = &LEUART0->TXDATA;
+            break;
+#endif
+        default:
+            MBED_ASSERT(0);
+            while(1);
+            break;
+    }
+
+    /* Descriptors are linked, so they have to outlive this function */
+    for(i = 0; i < count - 1; i++) {
+        LDMA_Descriptor_t desc = LDMA_DESCRIPTOR_LINKREL_M2P_BYTE(segments[i].buffer, target_addr, segments[i].length, 1);
+        /* Only the last segment should raise the done interrupt */
+        desc.xfer.doneIfs = 0;
+        obj->serial.tx_sg_desc[i] = desc;
+    }
+    LDMA_Descriptor_t last = LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(segments[count - 1].buffer, target_addr, segments[count - 1].length);
+    obj->serial.tx_sg_desc[count - 1] = last;
+
+    LDMA_TransferCfg_t xferConf = LDMA_TRANSFER_CFG_PERIPHERAL(dma_periph);
+    LDMAx_StartTransfer(obj->serial.dmaOptionsTX.dmaChannel, &xferConf, obj->serial.tx_sg_desc, serial_dmaTxQueueComplete, obj);
+}
+#endif
+
+/******************************************
+* static void serial_dmaCircularComplete(uint channel, bool primary, void* user)
+*
+* Callback function which gets called when one half of a circular RX buffer
+* has been filled. The user pointer is the serial object.
+******************************************/
+static void serial_dmaCircularComplete(unsigned int channel, bool primary, void *user)
+{
+    serial_t *obj = (serial_t *)user;
+    uint8_t slot = obj->serial.rx_circ_slot;
+    (void)channel;
+    (void)primary;
+
+    /* The descriptors are linked in a loop, so LDMA has already moved on to
+     * the other half. The finished descriptor is reloaded from memory when
+     * LDMA links back to it, so it only needs its buffer swapped. */
+    obj->serial.rx_circ_slot = slot ^ 1;
+    obj->serial.rx_circ_events |= serial_rx_circular_refill(obj, slot);
+    obj->serial.rx_circ_desc[slot].xfer.dstAddr = (uint32_t)obj->serial.rx_circ_buffer[slot];
+
+    /* Handler should be a thunk to CPP land */
+    if (obj->serial.rx_circ_handler != 0) {
+        ((DMACallback)obj->serial.rx_circ_handler)();
+    }
+}
+
+/******************************************
+* static void serial_dmaActivateCircular(serial_t *obj)
+*
+* Starts RX on two descriptors linked to each other, one per buffer half.
+******************************************/
+static void serial_dmaActivateCircular(serial_t *obj)
+{
+    LDMA_PeripheralSignal_t dma_periph;
+    volatile const void *source_addr;
+
+    switch((uint32_t)(obj->serial.periph.uart)) {
+#ifdef USART0
+        case USART_0:
+            dma_periph = ldmaPeripheralSignal_USART0_RXDATAV;
+            source_addr = &USART0->RXDATA;
+            obj->serial.periph.uart->CMD = serial_usart_rx_start_cmd(obj);
+            break;
+#endif
+#ifdef USART1
+        case USART_1:
+            dma_periph = ldmaPeripheralSignal_USART1_RXDATAV;
+            source_addr = &USART1->RXDATA;
+            obj->serial.periph.uart->CMD = serial_usart_rx_start_cmd(obj);
+            break;
+#endif
+#ifdef LEUART0
+        case LEUART_0:
+            dma_periph = ldmaPeripheralSignal_LEUART0_RXDATAV;
+            source_addr = &LEUART0->RXDATA;
+            obj->serial.periph.leuart->CMD = LEUART_CMD_CLEARRX;
+            obj->serial.periph.leuart->CMD = LEUART_CMD_RXEN;
+            while(obj->serial.periph.leuart->SYNCBUSY & LEUART_SYNCBUSY_CMD);
+            break;
+#endif
+        default:
+            MBED_ASSERT(0);
+            while(1);
+            break;
+    }
+
+    /* Descriptors are linked, so they have to outlive this function */
+    LDMA_Descriptor_t desc0 = LDMA_DESCRIPTOR_LINKREL_P2M_BYTE(source_addr, obj->serial.rx_circ_buffer[0], obj->serial.rx_circ_length[0], 1);
+    LDMA_Descriptor_t desc1 = LDMA_DESCRIPTOR_LINKREL_P2M_BYTE(source_addr, obj->serial.rx_circ_buffer[1], obj->serial.rx_circ_length[1], -1);
+    obj->serial.rx_circ_desc[0] = desc0;
+    obj->serial.rx_circ_desc[1] = desc1;
+    obj->serial.rx_circ_slot = 0;
+
+    LDMA_TransferCfg_t xferConf = LDMA_TRANSFER_CFG_PERIPHERAL(dma_periph);
+    LDMAx_StartTransfer(obj->serial.dmaOptionsRX.dmaChannel, &xferConf, &(obj->serial.rx_circ_desc[0]), serial_dmaCircularComplete, obj);
+}
+
+/******************************************
+* static size_t serial_dmaCircularIndex(serial_t *obj)
+*
+* Derives the write index from the remaining count of the active descriptor.
+******************************************/
+static size_t serial_dmaCircularIndex(serial_t *obj)
+{
+    int ch = obj->serial.dmaOptionsRX.dmaChannel;
+    uint32_t remaining;
+    uint8_t slot;
+
+    INT_Disable();
+    remaining = LDMA_TransferRemainingCount(ch);
+    slot = obj->serial.rx_circ_slot;
+    /* If LDMA already linked to the next descriptor but the interrupt has
+     * not been serviced yet, the count belongs to the other half */
+    if ((remaining != 0) && (LDMA->IF & (1 << ch))) {
+        slot ^= 1;
+    }
+    INT_Enable();
+
+    return ((slot ? obj->serial.rx_circ_length[0] : 0) + obj->serial.rx_circ_length[slot] - remaining)
+           % obj->rx_buff.length;
+}
+
 #endif /* LDMA_PRESENT */
 
 /************************************************************************************
@@ -1649,6 +2127,7 @@ int serial_tx_asynch(serial_t *obj, void *tx, size_t tx_length, uint8_t tx_width
 
     // If DMA, kick off DMA transfer
     if(obj->serial.dmaOptionsTX.dmaChannel >= 0) {
+        serial_leuart_dma_em2(obj, true, true);
         serial_dmaActivate(obj, (void*)handler, obj->tx_buff.buffer, obj->tx_buff.length, true);
     }
     // Else, activate interrupt. TXBL will take care of buffer filling through ISR.
@@ -1717,9 +2196,9 @@ void serial_rx_asynch(serial_t *obj, void *rx, size_t rx_length, uint8_t rx_widt
     serial_block_sleep(obj);
 
     // Determine DMA strategy
-    // If character match is enabled, we can't use DMA, sadly. We could when using LEUART though, but that support is not in here yet.
-    // TODO: add DMA support for character matching with leuart
-    if(!(event & SERIAL_EVENT_RX_CHARACTER_MATCH)) {
+    // If character match is enabled, we can't use DMA on USART, sadly. LEUART
+    // can match the character in hardware through its signal frame though.
+    if(!(event & SERIAL_EVENT_RX_CHARACTER_MATCH) || LEUART_REF_VALID(obj->serial.periph.leuart)) {
         serial_dmaTrySetState(&(obj->serial.dmaOptionsRX), hint, obj, false);
     }else{
         serial_dmaTrySetState(&(obj->serial.dmaOptionsRX), DMA_USAGE_NEVER, obj, false);
@@ -1727,6 +2206,20 @@ void serial_rx_asynch(serial_t *obj, void *rx, size_t rx_length, uint8_t rx_widt
 
     // If DMA, kick off DMA
     if(obj->serial.dmaOptionsRX.dmaChannel >= 0) {
+        if(event & SERIAL_EVENT_RX_CHARACTER_MATCH) {
+            // Only interrupt on the terminating character, DMA takes care of the rest
+            obj->serial.periph.leuart->SIGFRAME = char_match;
+            while(obj->serial.periph.leuart->SYNCBUSY & LEUART_SYNCBUSY_SIGFRAME);
+            LEUART_IntClear(obj->serial.periph.leuart, LEUART_IFC_SIGF);
+            LEUART_IntEnable(obj->serial.periph.leuart, LEUART_IEN_SIGF);
+
+            // Store callback
+            vIRQ_ClearPendingIRQ(serial_get_rx_irq_index(obj));
+            vIRQ_SetVector(serial_get_rx_irq_index(obj), (uint32_t)handler);
+            vIRQ_EnableIRQ(serial_get_rx_irq_index(obj));
+        }
+
+        serial_leuart_dma_em2(obj, false, true);
         serial_dmaActivate(obj, (void*)handler, obj->rx_buff.buffer, obj->rx_buff.length, false);
     }
     // Else, activate interrupt. RXDATAV is responsible for incoming data notification.
@@ -1746,7 +2239,7 @@ void serial_rx_asynch(serial_t *obj, void *rx, size_t rx_length, uint8_t rx_widt
             LEUART_IntEnable(obj->serial.periph.leuart, LEUART_IEN_RXDATAV);
         } else {
             // Activate RX and clear RX buffer
-            obj->serial.periph.uart->CMD = USART_CMD_RXEN | USART_CMD_CLEARRX;
+            obj->serial.periph.uart->CMD = serial_usart_rx_start_cmd(obj);
 
             // Clear RXFULL
             USART_IntClear(obj->serial.periph.uart, USART_IFC_RXFULL);
@@ -1759,6 +2252,369 @@ void serial_rx_asynch(serial_t *obj, void *rx, size_t rx_length, uint8_t rx_widt
     return;
 }
 
+/** Begin continuous RX into a circular buffer. DMA keeps running over the two
+ *  halves of the buffer until the transfer is aborted.
+ *
+ * @param obj       The serial object
+ * @param rx        The circular receive buffer
+ * @param rx_length Size of the buffer in bytes
+ * @param handler   The function to call when an event occurs
+ * @param event     The logical OR of events to be reported
+ * @param idle_bits Idle timeout in bit periods (USART with TIMECMP only), 0 to disable
+ * @return 0 on success, DMA_ERROR_OUT_OF_CHANNELS if no DMA channel was available,
+ *         SERIAL_ERROR_NO_IDLE if idle detection was asked for but is not supported,
+ *         or RX_IDLE was requested without an idle timeout
+ */
+int serial_rx_circular_asynch(serial_t *obj, void *rx, size_t rx_length, uint32_t handler, uint32_t event, uint8_t idle_bits)
+{
+    size_t half = rx_length / 2;
+
+    // Check that a buffer has indeed been set up, and that each half fits in one descriptor
+    MBED_ASSERT(rx != (void*)0);
+    MBED_ASSERT((half > 0) && ((rx_length - half) <= SERIAL_DMA_MAX_TRANSFER));
+
+    // Idle detection needs the USART timer and a timeout, don't silently run without them
+    if((idle_bits > 0) || (event & SERIAL_EVENT_RX_IDLE)) {
+#if defined(_USART_TIMECMP1_MASK)
+        if(LEUART_REF_VALID(obj->serial.periph.leuart) || (idle_bits == 0)) {
+            return SERIAL_ERROR_NO_IDLE;
+        }
+#else
+        return SERIAL_ERROR_NO_IDLE;
+#endif
+    }
+
+    // Set up buffer
+    serial_rx_buffer_set(obj, rx, rx_length, 8);
+    obj->serial.rx_circ_buffer[0] = (uint8_t *)rx;
+    obj->serial.rx_circ_buffer[1] = (uint8_t *)rx + half;
+    obj->serial.rx_circ_length[0] = half;
+    obj->serial.rx_circ_length[1] = rx_length - half;
+    obj->serial.rx_pool_active = false;
+
+    return serial_rx_circular_start(obj, handler, event, idle_bits);
+}
+
+#if SERIAL_RX_POOL_MAX > 0
+/** Begin zero-copy RX into a pool of buffers. See serial_api_HAL.h
+ *
+ * @param obj     The serial object
+ * @param buffers Array of buffers, all of the same size
+ * @param count   Number of buffers
+ * @param length  Size of each buffer in bytes
+ * @param handler The function to call when an event occurs
+ * @param event   The logical OR of events to be reported
+ * @return 0 on success, DMA_ERROR_OUT_OF_CHANNELS if no DMA channel was available
+ */
+int serial_rx_pool_asynch(serial_t *obj, void * const *buffers, uint8_t count, size_t length, uint32_t handler, uint32_t event)
+{
+    uint8_t i;
+
+    // Two buffers are always owned by DMA, so at least one more is needed to hand anything over
+    MBED_ASSERT(buffers != (void*)0);
+    MBED_ASSERT((count >= 3) && (count <= SERIAL_RX_POOL_MAX));
+    MBED_ASSERT((length > 0) && (length <= SERIAL_DMA_MAX_TRANSFER));
+
+    // Set up buffers
+    serial_rx_buffer_set(obj, buffers[0], length, 8);
+    obj->serial.rx_circ_buffer[0] = (uint8_t *)buffers[0];
+    obj->serial.rx_circ_buffer[1] = (uint8_t *)buffers[1];
+    obj->serial.rx_circ_length[0] = length;
+    obj->serial.rx_circ_length[1] = length;
+
+    obj->serial.rx_pool_free_head = 0;
+    obj->serial.rx_pool_free_count = 0;
+    obj->serial.rx_pool_full_head = 0;
+    obj->serial.rx_pool_full_count = 0;
+    for(i = 2; i < count; i++) {
+        obj->serial.rx_pool_free[obj->serial.rx_pool_free_count++] = (uint8_t *)buffers[i];
+    }
+    obj->serial.rx_pool_active = true;
+
+    return serial_rx_circular_start(obj, handler, event, 0);
+}
+
+/** Take ownership of the oldest filled buffer. See serial_api_HAL.h
+ *
+ * @param obj The serial object
+ * @return The buffer, or NULL if none has been filled
+ */
+void *serial_rx_pool_get(serial_t *obj)
+{
+    void *buffer = NULL;
+
+    INT_Disable();
+    if(obj->serial.rx_pool_full_count > 0) {
+        buffer = obj->serial.rx_pool_full[obj->serial.rx_pool_full_head];
+        obj->serial.rx_pool_full_head = (obj->serial.rx_pool_full_head + 1) % SERIAL_RX_POOL_MAX;
+        obj->serial.rx_pool_full_count--;
+    }
+    INT_Enable();
+
+    return buffer;
+}
+
+/** Give a buffer back to the driver. See serial_api_HAL.h
+ *
+ * @param obj    The serial object
+ * @param buffer The buffer
+ */
+void serial_rx_pool_release(serial_t *obj, void *buffer)
+{
+    MBED_ASSERT(buffer != (void*)0);
+
+    INT_Disable();
+    MBED_ASSERT(obj->serial.rx_pool_free_count < SERIAL_RX_POOL_MAX);
+    obj->serial.rx_pool_free[(obj->serial.rx_pool_free_head + obj->serial.rx_pool_free_count) % SERIAL_RX_POOL_MAX] = (uint8_t *)buffer;
+    obj->serial.rx_pool_free_count++;
+    INT_Enable();
+}
+#endif
+
+/** Pick the buffer a finished half of continuous reception continues with.
+ *  Called from the DMA interrupt, before the descriptor is re-armed.
+ *
+ * @param obj  The serial object
+ * @param slot The half that was just filled
+ * @return The event to report for it
+ */
+static uint32_t serial_rx_circular_refill(serial_t *obj, uint8_t slot)
+{
+    if(!obj->serial.rx_pool_active) {
+        /* Plain circular buffer, keep using the same half */
+        return (slot == 0) ? SERIAL_EVENT_RX_HALF : SERIAL_EVENT_RX_WRAP;
+    }
+
+#if SERIAL_RX_POOL_MAX > 0
+    if(obj->serial.rx_pool_free_count == 0) {
+        /* Application holds all spare buffers, so this one gets overwritten */
+        return SERIAL_EVENT_RX_POOL_EMPTY;
+    }
+
+    /* Hand the filled buffer over and continue with a free one */
+    obj->serial.rx_pool_full[(obj->serial.rx_pool_full_head + obj->serial.rx_pool_full_count) % SERIAL_RX_POOL_MAX] = obj->serial.rx_circ_buffer[slot];
+    obj->serial.rx_pool_full_count++;
+
+    obj->serial.rx_circ_buffer[slot] = obj->serial.rx_pool_free[obj->serial.rx_pool_free_head];
+    obj->serial.rx_pool_free_head = (obj->serial.rx_pool_free_head + 1) % SERIAL_RX_POOL_MAX;
+    obj->serial.rx_pool_free_count--;
+
+    return SERIAL_EVENT_RX_BUFFER;
+#else
+    return 0;
+#endif
+}
+
+/** Common part of starting continuous reception, once the two halves in
+ *  rx_circ_buffer/rx_circ_length have been set up.
+ */
+static int serial_rx_circular_start(serial_t *obj, uint32_t handler, uint32_t event, uint8_t idle_bits)
+{
+    // Continuous reception only makes sense with DMA
+    serial_dmaTrySetState(&(obj->serial.dmaOptionsRX), DMA_USAGE_OPPORTUNISTIC, obj, false);
+    if(obj->serial.dmaOptionsRX.dmaChannel < 0) {
+        obj->serial.rx_pool_active = false;
+        return DMA_ERROR_OUT_OF_CHANNELS;
+    }
+
+    obj->serial.rx_circ_events = 0;
+    obj->serial.rx_circ_handler = handler;
+    obj->serial.rx_circ_active = true;
+
+    /*clear all set interrupts*/
+    if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
+        LEUART_IntClear(obj->serial.periph.leuart, LEUART_IFC_PERR | LEUART_IFC_FERR | LEUART_IFC_RXOF);
+    }else{
+        USART_IntClear(obj->serial.periph.uart,  USART_IFC_PERR | USART_IFC_FERR | USART_IFC_RXOF);
+    }
+
+    // Set up events
+    serial_rx_enable_event(obj, SERIAL_EVENT_RX_ALL | SERIAL_EVENT_RX_HALF | SERIAL_EVENT_RX_WRAP | SERIAL_EVENT_RX_IDLE | SERIAL_EVENT_RX_BUFFER | SERIAL_EVENT_RX_POOL_EMPTY, false);
+    serial_rx_enable_event(obj, event, true);
+
+    // Set up sleepmode
+    serial_block_sleep(obj);
+
+    // Errors and idle timeouts are reported through the RX interrupt
+    vIRQ_ClearPendingIRQ(serial_get_rx_irq_index(obj));
+    vIRQ_SetVector(serial_get_rx_irq_index(obj), handler);
+    vIRQ_EnableIRQ(serial_get_rx_irq_index(obj));
+
+#if defined(_USART_TIMECMP1_MASK)
+    if(!LEUART_REF_VALID(obj->serial.periph.leuart) && (idle_bits > 0)) {
+        // Start counting at the end of each frame, stop when the next one starts
+        obj->serial.periph.uart->TIMECMP1 = USART_TIMECMP1_TSTART_RXEOF
+                                            | USART_TIMECMP1_TSTOP_RXACT
+                                            | USART_TIMECMP1_RESTARTEN
+                                            | ((uint32_t)idle_bits << _USART_TIMECMP1_TCMPVAL_SHIFT);
+        USART_IntClear(obj->serial.periph.uart, USART_IFC_TCMP1);
+        USART_IntEnable(obj->serial.periph.uart, USART_IEN_TCMP1);
+    }
+#else
+    (void)idle_bits;
+#endif
+
+    // Kick off DMA
+    serial_leuart_dma_em2(obj, false, true);
+    serial_dmaActivateCircular(obj);
+
+    return 0;
+}
+
+/** Get the write index of an ongoing continuous reception
+ *
+ * @param obj The serial object
+ * @return Offset in the circular buffer where the next byte will be stored
+ */
+size_t serial_rx_circular_index(serial_t *obj)
+{
+    if(!obj->serial.rx_circ_active) return 0;
+
+    return serial_dmaCircularIndex(obj);
+}
+
+#if SERIAL_TX_SEGMENTS_MAX > 0
+/** Transmit a list of buffers back-to-back, or queue them behind an ongoing
+ *  scatter-gather transmission. See serial_api_HAL.h
+ *
+ * @param obj      The serial object
+ * @param segments Array of buffers to send, in order
+ * @param count    Number of entries in segments
+ * @param handler  The function to call when an event occurs
+ * @param event    The logical OR of events to be reported
+ * @return 0 on success, negative error code otherwise
+ */
+int serial_tx_segments_asynch(serial_t *obj, const serial_tx_segment_t *segments, uint8_t count, uint32_t handler, uint32_t event)
+{
+#if SERIAL_TX_QUEUE_SIZE > 0
+    serial_tx_request_t *req;
+#endif
+    uint8_t i;
+
+    // Check that the request fits in our descriptor list
+    MBED_ASSERT(segments != (void*)0);
+    MBED_ASSERT((count > 0) && (count <= SERIAL_TX_SEGMENTS_MAX));
+    for(i = 0; i < count; i++) {
+        MBED_ASSERT((segments[i].buffer != (void*)0) && (segments[i].length > 0) && (segments[i].length <= SERIAL_DMA_MAX_TRANSFER));
+    }
+
+#if SERIAL_TX_QUEUE_SIZE > 0
+    // If a queued transmission is running, just append to it. The DMA
+    // interrupt picks requests up from the queue, so keep it out meanwhile.
+    INT_Disable();
+    if(obj->serial.tx_queue_active) {
+        if(obj->serial.tx_queue_count >= SERIAL_TX_QUEUE_SIZE) {
+            INT_Enable();
+            return SERIAL_ERROR_TX_BUSY;
+        }
+        req = &(obj->serial.tx_queue[(obj->serial.tx_queue_head + obj->serial.tx_queue_count) % SERIAL_TX_QUEUE_SIZE]);
+        memcpy(req->segments, segments, count * sizeof(serial_tx_segment_t));
+        req->count = count;
+        obj->serial.tx_queue_count++;
+        INT_Enable();
+        return 0;
+    }
+    INT_Enable();
+#endif
+
+    // Plain transfers can't be chained onto
+    if(serial_tx_active(obj)) return SERIAL_ERROR_TX_BUSY;
+
+    // Chaining segments is only possible with DMA
+    serial_dmaTrySetState(&(obj->serial.dmaOptionsTX), DMA_USAGE_OPPORTUNISTIC, obj, true);
+    if(obj->serial.dmaOptionsTX.dmaChannel < 0) {
+        return DMA_ERROR_OUT_OF_CHANNELS;
+    }
+
+    // Set up events
+    serial_tx_enable_event(obj, SERIAL_EVENT_TX_ALL, false);
+    serial_tx_enable_event(obj, event, true);
+
+    // Set up sleepmode, held until the whole queue has drained
+    serial_block_sleep(obj);
+
+#if SERIAL_TX_QUEUE_SIZE > 0
+    obj->serial.tx_queue_handler = handler;
+    obj->serial.tx_queue_head = 0;
+    obj->serial.tx_queue_count = 0;
+    obj->serial.tx_queue_done = 0;
+#endif
+    obj->serial.tx_queue_active = true;
+
+    if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
+        // Activate TX and clear TX buffer
+        LEUART_IntClear(obj->serial.periph.leuart, LEUART_IFC_TXC);
+        obj->serial.periph.leuart->CMD = LEUART_CMD_CLEARTX;
+        obj->serial.periph.leuart->CMD = LEUART_CMD_TXEN;
+        while(obj->serial.periph.leuart->SYNCBUSY & LEUART_SYNCBUSY_CMD);
+    } else {
+        // Activate TX and clear TX buffer
+        USART_IntClear(obj->serial.periph.uart, USART_IFC_TXC);
+        obj->serial.periph.uart->CMD = USART_CMD_TXEN | USART_CMD_CLEARTX;
+    }
+
+    // Set callback. TXC is armed by the DMA callback once the
+    // last queued request has been handed to the peripheral
+    vIRQ_SetVector(serial_get_tx_irq_index(obj), handler);
+    serial_irq_set(obj, TxIrq, true);
+    serial_tx_queue_txc(obj, false);
+
+    // Kick off DMA
+    serial_leuart_dma_em2(obj, true, true);
+    serial_dmaActivateSegments(obj, segments, count);
+
+    return 0;
+}
+
+#if SERIAL_TX_QUEUE_SIZE > 0
+/** Start the request at the head of the TX queue. Only called from interrupt
+ *  context, with the transmitter still running.
+ *
+ * @param obj The serial object
+ */
+static void serial_tx_queue_next(serial_t *obj)
+{
+    serial_tx_request_t *req = &(obj->serial.tx_queue[obj->serial.tx_queue_head]);
+
+    serial_dmaActivateSegments(obj, req->segments, req->count);
+
+    obj->serial.tx_queue_head = (obj->serial.tx_queue_head + 1) % SERIAL_TX_QUEUE_SIZE;
+    obj->serial.tx_queue_count--;
+}
+#endif
+
+/** Mask or arm TXC during a queued transmission. It is only meaningful after
+ *  the last request, and set by any gap between requests before that.
+ *
+ * @param obj The serial object
+ * @param arm True to arm, once the last request has been handed to DMA
+ */
+static void serial_tx_queue_txc(serial_t *obj, bool arm)
+{
+    if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
+        LEUART_IntDisable(obj->serial.periph.leuart, LEUART_IEN_TXC);
+        LEUART_IntClear(obj->serial.periph.leuart, LEUART_IFC_TXC);
+        if(arm) {
+            // The last frames may already be out, don't lose their TXC with the stale one
+            if(obj->serial.periph.leuart->STATUS & LEUART_STATUS_TXC) {
+                LEUART_IntSet(obj->serial.periph.leuart, LEUART_IFS_TXC);
+            }
+            LEUART_IntEnable(obj->serial.periph.leuart, LEUART_IEN_TXC);
+        }
+    } else {
+        USART_IntDisable(obj->serial.periph.uart, USART_IEN_TXC);
+        USART_IntClear(obj->serial.periph.uart, USART_IFC_TXC);
+        if(arm) {
+            // The last frames may already be out, don't lose their TXC with the stale one
+            if(obj->serial.periph.uart->STATUS & USART_STATUS_TXC) {
+                USART_IntSet(obj->serial.periph.uart, USART_IFS_TXC);
+            }
+            USART_IntEnable(obj->serial.periph.uart, USART_IEN_TXC);
+        }
+    }
+}
+#endif
+
 /** Attempts to determine if the serial peripheral is already in use for TX
  *
  * @param obj The serial object
@@ -1766,6 +2622,11 @@ void serial_rx_asynch(serial_t *obj, void *rx, size_t rx_length, uint8_t rx_widt
  */
 uint8_t serial_tx_active(serial_t *obj)
 {
+#if SERIAL_TX_SEGMENTS_MAX > 0
+    // TXC is masked while queued requests are being chained
+    if(obj->serial.tx_queue_active) return true;
+#endif
+
     if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
         return (obj->serial.periph.leuart->IEN & (LEUART_IEN_TXBL|LEUART_IEN_TXC)) ? true : false;
     } else {
@@ -1890,6 +2751,19 @@ int serial_rx_irq_handler_asynch(serial_t *obj)
             return SERIAL_EVENT_RX_OVERFLOW;
         }
 
+        if(LEUART_IntGetEnabled(obj->serial.periph.leuart) & LEUART_IF_SIGF) {
+            /* Signal frame matched during DMA reception. The character is still
+             * in RXDATA at this point, so let DMA move it to memory first. */
+            LEUART_IntClear(obj->serial.periph.leuart, LEUART_IFC_SIGF);
+#ifndef LDMA_PRESENT
+            while((LEUART_StatusGet(obj->serial.periph.leuart) & LEUART_STATUS_RXDATAV) && DMA_ChannelEnabled(obj->serial.dmaOptionsRX.dmaChannel));
+#else
+            while((LEUART_StatusGet(obj->serial.periph.leuart) & LEUART_STATUS_RXDATAV) && (LDMA->CHEN & (1 << obj->serial.dmaOptionsRX.dmaChannel)));
+#endif
+            serial_rx_abort_asynch_intern(obj, 1);
+            return SERIAL_EVENT_RX_CHARACTER_MATCH & obj->serial.events;
+        }
+
         if((LEUART_IntGetEnabled(obj->serial.periph.leuart) & LEUART_IF_RXDATAV) || (LEUART_StatusGet(obj->serial.periph.leuart) & LEUART_STATUS_RXDATAV)) {
             /* Valid data in buffer. Determine course of action: continue receiving or interrupt */
             if(obj->rx_buff.pos >= (obj->rx_buff.length - 1)) {
@@ -2002,6 +2876,7 @@ int serial_rx_irq_handler_asynch(serial_t *obj)
 int serial_irq_handler_asynch(serial_t *obj)
 {
     uint32_t txc_int;
+    int collected = 0;
 
     if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
         txc_int = LEUART_IntGetEnabled(obj->serial.periph.leuart) & LEUART_IF_TXC;
@@ -2009,17 +2884,63 @@ int serial_irq_handler_asynch(serial_t *obj)
         txc_int = USART_IntGetEnabled(obj->serial.periph.uart) & USART_IF_TXC;
     }
 
+    /* Continuous reception collects its events from the DMA callback */
+    if(obj->serial.rx_circ_active) {
+        INT_Disable();
+        collected = obj->serial.rx_circ_events;
+        obj->serial.rx_circ_events = 0;
+        INT_Enable();
+
+#if defined(_USART_TIMECMP1_MASK)
+        if(!LEUART_REF_VALID(obj->serial.periph.leuart) && (USART_IntGetEnabled(obj->serial.periph.uart) & USART_IF_TCMP1)) {
+            USART_IntClear(obj->serial.periph.uart, USART_IFC_TCMP1);
+            collected |= SERIAL_EVENT_RX_IDLE;
+        }
+#endif
+    }
+
+#if SERIAL_TX_QUEUE_SIZE > 0
+    /* Queued TX requests that were chained back-to-back complete without TXC */
+    INT_Disable();
+    if(obj->serial.tx_queue_done > 0) {
+        obj->serial.tx_queue_done--;
+        collected |= SERIAL_EVENT_TX_COMPLETE;
+    }
+    INT_Enable();
+#endif
+
+    /* Report both at once, there may be no further call to pick up the one left behind */
+    collected &= obj->serial.events;
+    if(collected) return collected;
+
     /* First, check if we're running in DMA mode */
     if( (obj->serial.dmaOptionsRX.dmaChannel != -1) &&
         serial_dma_irq_fired[obj->serial.dmaOptionsRX.dmaChannel]) {
+        int event = SERIAL_EVENT_RX_COMPLETE;
+
+        /* Buffer may have filled up exactly on the terminating character */
+        if((obj->serial.events & SERIAL_EVENT_RX_CHARACTER_MATCH) &&
+           (((uint8_t*)obj->rx_buff.buffer)[obj->rx_buff.length - 1] == obj->char_match)) {
+            event |= SERIAL_EVENT_RX_CHARACTER_MATCH;
+        }
+
         /* Clean up */
         serial_dma_irq_fired[obj->serial.dmaOptionsRX.dmaChannel] = false;
         serial_rx_abort_asynch_intern(obj, 1);
 
         /* Notify CPP land of RX completion */
-        return SERIAL_EVENT_RX_COMPLETE & obj->serial.events;
+        return event & obj->serial.events;
     } else if (txc_int && (obj->serial.dmaOptionsTX.dmaChannel != -1) &&
                serial_dma_irq_fired[obj->serial.dmaOptionsTX.dmaChannel]) {
+#if SERIAL_TX_QUEUE_SIZE > 0
+        if(obj->serial.tx_queue_active && (obj->serial.tx_queue_count > 0)) {
+            /* A request was queued while the previous one was draining, keep going */
+            serial_dma_irq_fired[obj->serial.dmaOptionsTX.dmaChannel] = false;
+            serial_tx_queue_txc(obj, false);
+            serial_tx_queue_next(obj);
+            return SERIAL_EVENT_TX_COMPLETE & obj->serial.events;
+        }
+#endif
         if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
             /* Clean up */
             serial_dma_irq_fired[obj->serial.dmaOptionsTX.dmaChannel] = false;
@@ -2038,7 +2959,7 @@ int serial_irq_handler_asynch(serial_t *obj)
          * Also make sure to prioritize RX */
         if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
             //Different method of checking tx vs rx for LEUART
-            if(LEUART_IntGetEnabled(obj->serial.periph.leuart) & (LEUART_IF_RXDATAV | LEUART_IF_FERR | LEUART_IF_PERR | LEUART_IF_RXOF)) {
+            if(LEUART_IntGetEnabled(obj->serial.periph.leuart) & (LEUART_IF_RXDATAV | LEUART_IF_FERR | LEUART_IF_PERR | LEUART_IF_RXOF | LEUART_IF_SIGF)) {
                 return serial_rx_irq_handler_asynch(obj);
             } else if(LEUART_StatusGet(obj->serial.periph.leuart) & (LEUART_STATUS_TXBL | LEUART_STATUS_TXC)) {
                 return serial_tx_irq_handler_asynch(obj);
@@ -2084,6 +3005,15 @@ static void serial_tx_abort_asynch_intern(serial_t *obj, int unblock_sleep)
     //
     // All in all, the logic was so fragile it's best to leave it out.
 
+    /* Drop whatever is still queued */
+#if SERIAL_TX_SEGMENTS_MAX > 0
+    obj->serial.tx_queue_active = false;
+#endif
+#if SERIAL_TX_QUEUE_SIZE > 0
+    obj->serial.tx_queue_count = 0;
+    obj->serial.tx_queue_done = 0;
+#endif
+
     /* Clean up */
     switch(obj->serial.dmaOptionsTX.dmaUsageState) {
         case DMA_USAGE_ALLOCATED:
@@ -2109,6 +3039,9 @@ static void serial_tx_abort_asynch_intern(serial_t *obj, int unblock_sleep)
             break;
     }
 
+    /* Stop waking up DMA from EM2 */
+    serial_leuart_dma_em2(obj, true, false);
+
     /* stop interrupting */
     if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
         LEUART_IntDisable(obj->serial.periph.leuart, LEUART_IEN_TXBL);
@@ -2126,18 +3059,45 @@ static void serial_tx_abort_asynch_intern(serial_t *obj, int unblock_sleep)
 }
 
 
+/**
+ * Check whether this is an LEUART running off the LF clock tree, which keeps
+ * working (and can keep feeding DMA) while the core sits in EM2.
+ */
+static bool serial_leuart_in_em2(serial_t *obj)
+{
+#ifdef LEUART_USING_LFXO
+    return LEUART_REF_VALID(obj->serial.periph.leuart) && (LEUART_BaudrateGet(obj->serial.periph.leuart) <= (LEUART_LF_REF_FREQ/2));
+#else
+    (void)obj;
+    return false;
+#endif
+}
+
+/**
+ * Let the LEUART wake up DMA in EM2 for the duration of a DMA transfer.
+ * Only done during transfers, since TXBL is set whenever the LEUART is idle
+ * and would otherwise keep waking up the DMA controller.
+ */
+static void serial_leuart_dma_em2(serial_t *obj, bool tx_nrx, bool enable)
+{
+    if(!LEUART_REF_VALID(obj->serial.periph.leuart)) return;
+    if(enable && !serial_leuart_in_em2(obj)) return;
+
+    if(tx_nrx) {
+        LEUART_TxDmaInEM2Enable(obj->serial.periph.leuart, enable);
+    } else {
+        LEUART_RxDmaInEM2Enable(obj->serial.periph.leuart, enable);
+    }
+}
+
 static void serial_unblock_sleep(serial_t *obj)
 {
     if( obj->serial.sleep_blocked > 0 ) {
-#ifdef LEUART_USING_LFXO
-        if(LEUART_REF_VALID(obj->serial.periph.leuart) && (LEUART_BaudrateGet(obj->serial.periph.leuart) <= (LEUART_LF_REF_FREQ/2))){
+        if(serial_leuart_in_em2(obj)){
             unblockSleepMode(SERIAL_LEAST_ACTIVE_SLEEPMODE_LEUART);
         }else{
             unblockSleepMode(SERIAL_LEAST_ACTIVE_SLEEPMODE);
         }
-#else
-        unblockSleepMode(SERIAL_LEAST_ACTIVE_SLEEPMODE);
-#endif
         obj->serial.sleep_blocked--;
     }
 }
@@ -2145,15 +3105,11 @@ static void serial_unblock_sleep(serial_t *obj)
 static void serial_block_sleep(serial_t *obj)
 {
     obj->serial.sleep_blocked++;
-#ifdef LEUART_USING_LFXO
-    if(LEUART_REF_VALID(obj->serial.periph.leuart) && (LEUART_BaudrateGet(obj->serial.periph.leuart) <= (LEUART_LF_REF_FREQ/2))){
+    if(serial_leuart_in_em2(obj)){
         blockSleepMode(SERIAL_LEAST_ACTIVE_SLEEPMODE_LEUART);
     }else{
         blockSleepMode(SERIAL_LEAST_ACTIVE_SLEEPMODE);
     }
-#else
-    blockSleepMode(SERIAL_LEAST_ACTIVE_SLEEPMODE);
-#endif
 }
 
 /** Abort the ongoing RX transaction It disables the enabled interrupt for RX and
@@ -2168,11 +3124,28 @@ void serial_rx_abort_asynch(serial_t *obj)
 
 static void serial_rx_abort_asynch_intern(serial_t *obj, int unblock_sleep)
 {
+    /* Continuous reception never completes by itself, so whoever stops it
+     * also has to release its sleep mode block */
+    if(obj->serial.rx_circ_active) {
+        obj->serial.rx_circ_active = false;
+        obj->serial.rx_pool_active = false;
+        obj->serial.rx_circ_handler = 0;
+        unblock_sleep = 1;
+#if defined(_USART_TIMECMP1_MASK)
+        if(!LEUART_REF_VALID(obj->serial.periph.leuart)) {
+            USART_IntDisable(obj->serial.periph.uart, USART_IEN_TCMP1);
+            obj->serial.periph.uart->TIMECMP1 = _USART_TIMECMP1_RESETVALUE;
+            USART_IntClear(obj->serial.periph.uart, USART_IFC_TCMP1);
+        }
+#endif
+    }
+
     /* Stop receiver */
     if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
         obj->serial.periph.leuart->CMD = LEUART_CMD_RXDIS;
         while(obj->serial.periph.leuart->SYNCBUSY & LEUART_SYNCBUSY_CMD);
-    } else {
+    } else if(!serial_rts_enabled(obj)) {
+        /* With RTS flow control, leave the receiver on so RTS holds off the peer */
         obj->serial.periph.uart->CMD = USART_CMD_RXDIS;
     }
 
@@ -2207,9 +3180,13 @@ static void serial_rx_abort_asynch_intern(serial_t *obj, int unblock_sleep)
             break;
     }
 
+    /* Stop waking up DMA from EM2 */
+    serial_leuart_dma_em2(obj, false, false);
+
     /*clear all set interrupts*/
     if(LEUART_REF_VALID(obj->serial.periph.leuart)) {
-        LEUART_IntClear(obj->serial.periph.leuart, LEUART_IFC_PERR | LEUART_IFC_FERR | LEUART_IFC_RXOF);
+        LEUART_IntDisable(obj->serial.periph.leuart, LEUART_IEN_SIGF);
+        LEUART_IntClear(obj->serial.periph.leuart, LEUART_IFC_PERR | LEUART_IFC_FERR | LEUART_IFC_RXOF | LEUART_IFC_SIGF);
     }else{
         USART_IntClear(obj->serial.periph.uart,  USART_IFC_PERR | USART_IFC_FERR | USART_IFC_RXOF);
     }
@@ -27,6 +27,7 @@
 #include "cmsis-core/cmsis.h"
 
 #include "mbed-hal/sleep_api.h"
+#include "mbed-hal/us_ticker_api.h"
 
 #include "mbed-hal-efm32/sleepmodes.h"
 
@@ -124,4 +125,33 @@ void unblockSleepMode(sleepstate_enum minimumMode)
     INT_Enable();
 }
 
+/** Sleep as long as the masked bits of a flag keep a given value
+ *
+ * The flag is checked with interrupts disabled. They still wake the core,
+ * so a change made by an interrupt handler can't slip in between the check
+ * and going to sleep. With a timeout, something must wake the core now and
+ * then, the us ticker overflow does.
+ *
+ * @param flag       Word changed from an interrupt, or a peripheral register
+ * @param mask       Bits of the flag to look at
+ * @param value      Keep sleeping while (*flag & mask) == value
+ * @param timeout_us Give up after this many microseconds, 0 to wait forever
+ * @return (*flag & mask) on return, which is value on a timeout
+ */
+uint32_t sleep_while(volatile const uint32_t *flag, uint32_t mask, uint32_t value, uint32_t timeout_us)
+{
+    uint32_t start = (timeout_us > 0) ? us_ticker_read() : 0;
+    uint32_t current;
+
+    INT_Disable();
+    while (((current = (*flag & mask)) == value) && ((timeout_us == 0) || ((us_ticker_read() - start) < timeout_us))) {
+        sleep();
+        INT_Enable();
+        INT_Disable();
+    }
+    INT_Enable();
+
+    return current;
+}
+
 #endif
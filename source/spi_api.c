@@ -37,15 +37,31 @@
 #include "mbed-hal-efm32/error.h"
 #include "mbed-hal-efm32/dma_api_HAL.h"
 #include "mbed-hal-efm32/sleepmodes.h"
+#include "mbed-hal-efm32/usart_baud.h"
+#include "mbed-hal-efm32/spi_api_HAL.h"
+#include "mbed-hal-efm32/gpio_irq_api_HAL.h"
 
 #include "em_usart.h"
 #include "em_cmu.h"
 #include "em_dma.h"
+#include "em_bus.h"
+#include "em_gpio.h"
+#include "em_int.h"
 
 #include "uvisor-lib/uvisor-lib.h"
 
 static uint16_t fill_word = (uint16_t)SPI_FILL_WORD;
 #define SPI_LEAST_ACTIVE_SLEEPMODE EM1
+/* Frames written but not read back yet in spi_master_block_write. Two fit in the RX buffer, one more in the shift register. */
+#define SPI_BLOCK_IN_FLIGHT_MAX 3
+
+static void spi_route_cs(spi_t *obj, PinName cs);
+
+#ifdef LDMA_PRESENT
+#define SPI_DMA_MAX_TRANSFER ((_LDMA_CH_CTRL_XFERCNT_MASK >> _LDMA_CH_CTRL_XFERCNT_SHIFT) + 1)
+#else
+#define SPI_DMA_MAX_TRANSFER ((_DMA_CTRL_N_MINUS_1_MASK >> _DMA_CTRL_N_MINUS_1_SHIFT) + 1)
+#endif
 
 static inline CMU_Clock_TypeDef spi_get_clock_tree(spi_t *obj)
 {
@@ -99,6 +115,23 @@ uint8_t spi_get_module(spi_t *obj)
     return spi_get_index(obj);
 }
 
+/* Hand the chip select pin to the USART, if configured. Needs to be redone after USART_InitSync. */
+static void spi_auto_cs_enable(spi_t *obj)
+{
+    /* A slave's chip select is an input */
+    if (obj->spi.cs_pin == NC || !obj->spi.master) {
+        return;
+    }
+
+#ifdef _USART_TIMING_CSHOLD_MASK
+    /* TIMING knows 0-3 and 7 bit periods, round up to what the hardware can do */
+    obj->spi.spi->TIMING = (obj->spi.spi->TIMING & ~(_USART_TIMING_CSSETUP_MASK | _USART_TIMING_CSHOLD_MASK))
+                           | ((obj->spi.cs_setup <= 3 ? obj->spi.cs_setup : _USART_TIMING_CSSETUP_SEVEN) << _USART_TIMING_CSSETUP_SHIFT)
+                           | ((obj->spi.cs_hold <= 3 ? obj->spi.cs_hold : _USART_TIMING_CSHOLD_SEVEN) << _USART_TIMING_CSHOLD_SHIFT);
+#endif
+    obj->spi.spi->CTRL |= USART_CTRL_AUTOCS;
+}
+
 static void usart_init(spi_t *obj, uint32_t baudrate, USART_Databits_TypeDef databits, bool master, USART_ClockMode_TypeDef clockMode )
 {
     USART_InitSync_TypeDef init = USART_INITSYNC_DEFAULT;
@@ -113,6 +146,7 @@ static void usart_init(spi_t *obj, uint32_t baudrate, USART_Databits_TypeDef dat
     init.refFreq = REFERENCE_FREQUENCY;
 
     USART_InitSync(obj->spi.spi, &init);
+    spi_auto_cs_enable(obj);
 }
 
 void spi_preinit(spi_t *obj, PinName mosi, PinName miso, PinName clk)
@@ -137,12 +171,24 @@ void spi_preinit(spi_t *obj, PinName mosi, PinName miso, PinName clk)
     MBED_ASSERT(obj->spi.location != NC);
 #endif
 
+    obj->spi.master = true;
+    obj->spi.cs_pin = NC;
     obj->spi.dmaOptionsTX.dmaUsageState = DMA_USAGE_OPPORTUNISTIC;
+    obj->spi.queue_device = NULL;
+    obj->spi.queue_active = false;
+#if SPI_TRANSACTION_QUEUE_SIZE > 0
+    obj->spi.queue_head = 0;
+    obj->spi.queue_count = 0;
+#endif
+    obj->spi.slave_handler = 0;
+    obj->spi.slave_received = 0;
+    obj->spi.slave_next_valid = false;
+    obj->spi.slave_active = false;
 }
 
 void spi_enable_pins(spi_t *obj, uint8_t enable, PinName mosi, PinName miso, PinName clk)
 {
-    if (enable) {
+    if (enable && obj->spi.master) {
         /* Master mode */
         /* Either mosi or miso can be NC */
         if (mosi != NC) {
@@ -153,6 +199,16 @@ void spi_enable_pins(spi_t *obj, uint8_t enable, PinName mosi, PinName miso, Pin
         }
         pin_mode(clk, PushPull);
         /* Don't set cs pin, since we toggle it manually */
+    } else if (enable) {
+        /* Slave mode, the master drives the clock */
+        if (mosi != NC) {
+            pin_mode(mosi, Input);
+        }
+        if (miso != NC) {
+            pin_mode(miso, PushPull);
+        }
+        pin_mode(clk, Input);
+        /* cs pin is set up by spi_slave_init */
     } else {
         // TODO_LP return PinMode to the previous state
         /* Either mosi or miso can be NC */
@@ -211,6 +267,25 @@ void spi_init(spi_t *obj, PinName mosi, PinName miso, PinName clk)
     spi_enable(obj, true);
 }
 
+void spi_slave_init(spi_t *obj, PinName mosi, PinName miso, PinName clk, PinName cs)
+{
+    CMU_ClockEnable(cmuClock_HFPER, true);
+    spi_preinit(obj, mosi, miso, clk);
+    obj->spi.master = false;
+    CMU_ClockEnable(spi_get_clock_tree(obj), true);
+    usart_init(obj, 100000, usartDatabits8, false, usartClockMode0);
+
+    spi_enable_pins(obj, true, mosi, miso, clk);
+
+    /* The USART ignores the bus while not selected */
+    MBED_ASSERT(cs != NC);
+    obj->spi.cs_pin = cs;
+    GPIO_PinModeSet((GPIO_Port_TypeDef)(cs >> 4 & 0xF), cs & 0xF, gpioModeInput, 0);
+    spi_route_cs(obj, cs);
+
+    spi_enable(obj, true);
+}
+
 void spi_enable_event(spi_t *obj, uint32_t event, uint8_t enable)
 {
     if(enable) obj->spi.event |= event;
@@ -263,32 +338,92 @@ void spi_enable_interrupt(spi_t *obj, uint32_t handler, uint8_t enable)
     }
 }
 
-void spi_format(spi_t *obj, int bits, int mode, spi_bitorder_t order)
+/****************************************************************************
+* static void spi_enable_txc_interrupt(spi_t *obj, uint32_t handler, uint8_t enable)
+*
+* This will enable the transmit complete interrupt on the associated USART TX
+* channel, used to finish DMA transfers once the last frame has been shifted out
+*
+*   * obj: pointer to spi object
+*   * handler: pointer to interrupt handler for this channel
+*   * enable: Whether to enable (true) or disable (false) the interrupt
+*
+****************************************************************************/
+static void spi_enable_txc_interrupt(spi_t *obj, uint32_t handler, uint8_t enable)
 {
-    /* Bits: values between 4 and 16 are valid */
-    MBED_ASSERT(bits >= 4 && bits <= 16);
-    obj->spi.bits = bits;
-    /* 0x01 = usartDatabits4, etc, up to 0x0D = usartDatabits16 */
-    USART_Databits_TypeDef databits = (USART_Databits_TypeDef) (bits - 3);
+    IRQn_Type IRQvector;
+
+    switch ((uint32_t)obj->spi.spi) {
+#ifdef USART0
+        case USART_0:
+            IRQvector = USART0_TX_IRQn;
+            break;
+#endif
+#ifdef USART1
+        case USART_1:
+            IRQvector = USART1_TX_IRQn;
+            break;
+#endif
+#ifdef USART2
+        case USART_2:
+            IRQvector = USART2_TX_IRQn;
+            break;
+#endif
+        default:
+            error("Undefined SPI peripheral");
+            return;
+    }
 
-    USART_ClockMode_TypeDef clockMode;
+    if (enable == true) {
+        vIRQ_SetVector(IRQvector, handler);
+        /* The DMA interrupt runs the same handler, neither may preempt the other */
+#ifdef LDMA_PRESENT
+        vIRQ_SetPriority(IRQvector, NVIC_GetPriority(LDMA_IRQn));
+#else
+        vIRQ_SetPriority(IRQvector, NVIC_GetPriority(DMA_IRQn));
+#endif
+        /* The flag may be left over from a gap earlier in the transfer */
+        USART_IntClear(obj->spi.spi, USART_IFC_TXC);
+        USART_IntEnable(obj->spi.spi, USART_IEN_TXC);
+        /* Don't lose a completion that slipped in before the flag was cleared */
+        if (obj->spi.spi->STATUS & USART_STATUS_TXC) {
+            USART_IntSet(obj->spi.spi, USART_IFS_TXC);
+        }
+        vIRQ_EnableIRQ(IRQvector);
+    } else {
+        USART_IntDisable(obj->spi.spi, USART_IEN_TXC);
+        USART_IntClear(obj->spi.spi, USART_IFC_TXC);
+        vIRQ_DisableIRQ(IRQvector);
+        vIRQ_ClearPendingIRQ(IRQvector);
+    }
+}
+
+static USART_ClockMode_TypeDef spi_clock_mode(int mode)
+{
     MBED_ASSERT(mode >= 0 && mode <= 3);
     switch (mode) {
         case 0:
-            clockMode = usartClockMode0;
-            break;
+            return usartClockMode0;
         case 1:
-            clockMode = usartClockMode1;
-            break;
+            return usartClockMode1;
         case 2:
-            clockMode = usartClockMode2;
-            break;
+            return usartClockMode2;
         case 3:
-            clockMode = usartClockMode3;
-            break;
+            return usartClockMode3;
         default:
-            clockMode = usartClockMode0;
+            return usartClockMode0;
     }
+}
+
+void spi_format(spi_t *obj, int bits, int mode, spi_bitorder_t order)
+{
+    /* Bits: values between 4 and 16 are valid */
+    MBED_ASSERT(bits >= 4 && bits <= 16);
+    obj->spi.bits = bits;
+    /* 0x01 = usartDatabits4, etc, up to 0x0D = usartDatabits16 */
+    USART_Databits_TypeDef databits = (USART_Databits_TypeDef) (bits - 3);
+
+    USART_ClockMode_TypeDef clockMode = spi_clock_mode(mode);
 
     // set bit ordering
     obj->spi.msbf = (order == SPI_MSB) ? 1 : 0;
@@ -303,7 +438,7 @@ void spi_format(spi_t *obj, int bits, int mode, spi_bitorder_t order)
     uint32_t iflags = obj->spi.spi->IEN;
     bool enabled = (obj->spi.spi->STATUS & (USART_STATUS_RXENS | USART_STATUS_TXENS)) != 0;
 
-    usart_init(obj, 100000, databits, true, clockMode);
+    usart_init(obj, 100000, databits, obj->spi.master, clockMode);
 
     //restore state
 #ifdef _USART_ROUTEPEN_RESETVALUE
@@ -315,11 +450,60 @@ void spi_format(spi_t *obj, int bits, int mode, spi_bitorder_t order)
     obj->spi.spi->IEN = iflags;
 
     if(enabled) spi_enable(obj, enabled);
+
+    /* Bus settings no longer match the last queued device */
+    obj->spi.queue_device = NULL;
 }
 
 void spi_frequency(spi_t *obj, int hz)
 {
-    USART_BaudrateSyncSet(obj->spi.spi, REFERENCE_FREQUENCY, hz);
+    usart_baud_sync_set(obj->spi.spi, REFERENCE_FREQUENCY, hz);
+    obj->spi.queue_device = NULL;
+}
+
+/* Route a pin to the CS function of the USART */
+static void spi_route_cs(spi_t *obj, PinName cs)
+{
+    MBED_ASSERT((USART_TypeDef *)pinmap_peripheral(cs, PinMap_SPI_CS) == obj->spi.spi);
+#ifdef _USART_ROUTEPEN_RESETVALUE
+    obj->spi.spi->ROUTELOC0 &= ~_USART_ROUTELOC0_CSLOC_MASK;
+    obj->spi.spi->ROUTELOC0 |= pin_location(cs, PinMap_SPI_CS)<<_USART_ROUTELOC0_CSLOC_SHIFT;
+    obj->spi.spi->ROUTEPEN |= USART_ROUTEPEN_CSPEN;
+#else
+    /* All pins of a USART share one location */
+    MBED_ASSERT(pin_location(cs, PinMap_SPI_CS) == (uint32_t)obj->spi.location);
+    obj->spi.spi->ROUTE |= USART_ROUTE_CSPEN;
+#endif
+}
+
+void spi_auto_cs(spi_t *obj, PinName cs, uint8_t setup, uint8_t hold)
+{
+    MBED_ASSERT(obj->spi.master);
+
+    /* Give the previous pin back to software, keeping the device deselected */
+    if (obj->spi.cs_pin != NC) {
+        obj->spi.spi->CTRL &= ~USART_CTRL_AUTOCS;
+#ifdef _USART_ROUTEPEN_RESETVALUE
+        obj->spi.spi->ROUTEPEN &= ~USART_ROUTEPEN_CSPEN;
+#else
+        obj->spi.spi->ROUTE &= ~USART_ROUTE_CSPEN;
+#endif
+        GPIO_PinModeSet((GPIO_Port_TypeDef)(obj->spi.cs_pin >> 4 & 0xF), obj->spi.cs_pin & 0xF, gpioModePushPull, 1);
+    }
+
+    obj->spi.cs_pin = cs;
+    obj->spi.cs_setup = setup;
+    obj->spi.cs_hold = hold;
+
+    if (cs == NC) {
+        return;
+    }
+
+    GPIO_PinModeSet((GPIO_Port_TypeDef)(cs >> 4 & 0xF), cs & 0xF, gpioModePushPull, 1);
+
+    /* Enable AUTOCS before routing, so the pin never drops while idle */
+    spi_auto_cs_enable(obj);
+    spi_route_cs(obj, cs);
 }
 
 /* Read/Write */
@@ -362,6 +546,69 @@ int spi_master_write(spi_t *obj, int value)
     return spi_read(obj);
 }
 
+int spi_master_block_write(spi_t *obj, const void *tx, int tx_length, void *rx, int rx_length)
+{
+    USART_TypeDef *usart = obj->spi.spi;
+    int total = (tx_length > rx_length ? tx_length : rx_length);
+    int tx_count = 0;
+    int rx_count = 0;
+    uint32_t fill = (uint32_t)SPI_FILL_WORD & (obj->spi.bits <= 8 ? 0xFF : (obj->spi.bits == 9 ? 0x1FF : 0xFFFF));
+
+    if (tx == NULL) {
+        tx_length = 0;
+    }
+    if (rx == NULL) {
+        rx_length = 0;
+    }
+
+    usart->CMD = USART_CMD_CLEARRX;
+
+    while (rx_count < total) {
+        /* Refill as soon as the TX buffer runs empty, while the last frame is still shifting out */
+        if ((tx_count < total) && (usart->STATUS & USART_STATUS_TXBL)) {
+            if (obj->spi.bits <= 8) {
+                if ((total - tx_count >= 2) && (tx_count - rx_count + 2 <= SPI_BLOCK_IN_FLIGHT_MAX)) {
+                    /* Two frames in one write */
+                    uint32_t frame0 = (tx_count < tx_length ? ((const uint8_t *)tx)[tx_count] : fill);
+                    uint32_t frame1 = (tx_count + 1 < tx_length ? ((const uint8_t *)tx)[tx_count + 1] : fill);
+                    usart->TXDOUBLE = frame0 | (frame1 << _USART_TXDOUBLE_TXDATA1_SHIFT);
+                    tx_count += 2;
+                } else if (tx_count - rx_count + 1 <= SPI_BLOCK_IN_FLIGHT_MAX) {
+                    usart->TXDATA = (tx_count < tx_length ? ((const uint8_t *)tx)[tx_count] : fill);
+                    tx_count++;
+                }
+            } else if (tx_count - rx_count + 1 <= SPI_BLOCK_IN_FLIGHT_MAX) {
+                spi_write(obj, (tx_count < tx_length ? ((const uint16_t *)tx)[tx_count] : fill));
+                tx_count++;
+            }
+        }
+
+        /* Drain RX, two frames at a time when the buffer is full */
+        if ((obj->spi.bits <= 8) && (usart->STATUS & USART_STATUS_RXFULL)) {
+            uint32_t frames = usart->RXDOUBLE;
+            if (rx_count < rx_length) {
+                ((uint8_t *)rx)[rx_count] = frames & 0xFF;
+            }
+            if (rx_count + 1 < rx_length) {
+                ((uint8_t *)rx)[rx_count + 1] = (frames >> _USART_RXDOUBLE_RXDATA1_SHIFT) & 0xFF;
+            }
+            rx_count += 2;
+        } else if (usart->STATUS & USART_STATUS_RXDATAV) {
+            int frame = spi_read(obj);
+            if (rx_count < rx_length) {
+                if (obj->spi.bits <= 8) {
+                    ((uint8_t *)rx)[rx_count] = frame;
+                } else {
+                    ((uint16_t *)rx)[rx_count] = frame;
+                }
+            }
+            rx_count++;
+        }
+    }
+
+    return total;
+}
+
 inline uint8_t spi_master_tx_ready(spi_t *obj)
 {
     return (obj->spi.spi->STATUS & USART_STATUS_TXBL) ? true : false;
@@ -405,9 +652,11 @@ uint8_t spi_active(spi_t *obj)
         case DMA_USAGE_ALLOCATED:
             /* Check whether the allocated DMA channel is active */
 #ifdef LDMA_PRESENT
-            return(LDMAx_ChannelEnabled(obj->spi.dmaOptionsTX.dmaChannel) || LDMAx_ChannelEnabled(obj->spi.dmaOptionsRX.dmaChannel));
+            return(LDMAx_ChannelEnabled(obj->spi.dmaOptionsTX.dmaChannel) || LDMAx_ChannelEnabled(obj->spi.dmaOptionsRX.dmaChannel)
+                   || (obj->spi.spi->IEN & USART_IEN_TXC));
 #else
-            return(DMA_ChannelEnabled(obj->spi.dmaOptionsTX.dmaChannel) || DMA_ChannelEnabled(obj->spi.dmaOptionsRX.dmaChannel));
+            return(DMA_ChannelEnabled(obj->spi.dmaOptionsTX.dmaChannel) || DMA_ChannelEnabled(obj->spi.dmaOptionsRX.dmaChannel)
+                   || (obj->spi.spi->IEN & USART_IEN_TXC));
 #endif
         default:
             /* Check whether interrupt for spi is enabled */
@@ -748,210 +997,268 @@ static void spi_master_dma_channel_setup(spi_t *obj, void* callback)
 }
 #endif // LDMA_PRESENT
 /******************************************
-* void spi_activate_dma(spi_t *obj, void* rxdata, void* txdata, int length)
-*
-* This function will start the DMA engine for SPI transfers
+* static uint32_t spi_dma_frames(spi_t *obj)
 *
-*   * rxdata: pointer to RX buffer, if needed.
-*   * txdata: pointer to TX buffer, if needed. Else FF's.
-*   * tx_length: how many bytes will get sent.
-*   * rx_length: how many bytes will get received. If > tx_length, TX will get padded with n lower bits of SPI_FILL_WORD.
+* Total amount of frames clocked for the current transfer. When more is
+* received than sent, TX gets padded with the fill word.
 ******************************************/
-#ifdef LDMA_PRESENT
-static void spi_activate_dma(spi_t *obj, void* rxdata, const void* txdata, int tx_length, int rx_length)
-{
-    LDMA_PeripheralSignal_t dma_periph;
-
-    if( txdata ) {
-        volatile void *target_addr;
-
-        /* Select TX target address. 9 bit frame length requires to use extended register.
-           10 bit and larger frame requires to use TXDOUBLE register. */
-        switch((int)obj->spi.spi) {
-            case USART_0:
-                dma_periph = ldmaPeripheralSignal_USART0_TXBL;
-                if(obj->spi.bits <= 8){
-                    target_addr = &USART0->TXDATA;
-                }else if(obj->spi.bits == 9){
-                    target_addr = &USART0->TXDATAX;
-                }else{
-                    target_addr = &USART0->TXDOUBLE;
-                }
-                break;
-            case USART_1:
-                dma_periph = ldmaPeripheralSignal_USART1_TXBL;
-                if(obj->spi.bits <= 8){
-                    target_addr = &USART1->TXDATA;
-                }else if(obj->spi.bits == 9){
-                    target_addr = &USART1->TXDATAX;
-                }else{
-                    target_addr = &USART1->TXDOUBLE;
-                }
-                break;
-            default:
-                EFM_ASSERT(0);
-                while(1);
-                break;
-        }
-
-        /*  Check the transmit lenght, and split long transfers to smaller ones*/
-        int max_length = 1024;
-#ifdef _LDMA_CH_CTRL_XFERCNT_MASK
-        max_length = (_LDMA_CH_CTRL_XFERCNT_MASK>>_LDMA_CH_CTRL_XFERCNT_SHIFT)+1;
-#endif
-        if(tx_length>max_length){
-            tx_length = max_length;
-        }
-
-        /* Save amount of TX done by DMA */
-        obj->tx_buff.pos += tx_length;
+static uint32_t spi_dma_frames(spi_t *obj)
+{
+    return (obj->tx_buff.length > obj->rx_buff.length ? obj->tx_buff.length : obj->rx_buff.length);
+}
 
-        LDMA_TransferCfg_t xferConf = LDMA_TRANSFER_CFG_PERIPHERAL(dma_periph);
-        LDMA_Descriptor_t desc = LDMA_DESCRIPTOR_SINGLE_M2P_BYTE(txdata, target_addr, tx_length);
-        if(obj->spi.bits >= 9){
-            desc.xfer.size = ldmaCtrlSizeHalf;
-        }
-        LDMAx_StartTransfer(obj->spi.dmaOptionsTX.dmaChannel, &xferConf, &desc, serial_dmaTransferComplete,obj->spi.dmaOptionsRX.dmaCallback.userPtr);
-
-    }
-    if(rxdata) {
-        volatile const void *source_addr;
-        /* Select RX source address. 9 bit frame length requires to use extended register.
-           10 bit and larger frame requires to use RXDOUBLE register. */
-        switch((int)obj->spi.spi) {
-            case USART_0:
-                dma_periph = ldmaPeripheralSignal_USART0_RXDATAV;
-                if(obj->spi.bits <= 8){
-                    source_addr = &USART0->RXDATA;
-                }else if(obj->spi.bits == 9){
-                    source_addr = &USART0->RXDATAX;
-                }else{
-                    source_addr = &USART0->RXDOUBLE;
-                }
-                break;
-            case USART_1:
-                dma_periph = ldmaPeripheralSignal_USART1_RXDATAV;
-                if(obj->spi.bits <= 8){
-                    source_addr = &USART1->RXDATA;
-                }else if(obj->spi.bits == 9){
-                    source_addr = &USART1->RXDATAX;
-                }else{
-                    source_addr = &USART1->RXDOUBLE;
-                }
-                break;
-            default:
-                EFM_ASSERT(0);
-                while(1);
-                break;
-        }
+/******************************************
+* static uint32_t spi_dma_batch_end(spi_t *obj)
+*
+* Frame at which the descriptor lists starting at tx_buff.pos end. One
+* descriptor is kept spare for the switch from the TX buffer to the fill word.
+******************************************/
+static uint32_t spi_dma_batch_end(spi_t *obj)
+{
+    uint32_t frames = spi_dma_frames(obj);
+    uint32_t end = obj->tx_buff.pos + (SPI_DMA_DESCRIPTORS_MAX - 1) * SPI_DMA_MAX_TRANSFER;
 
-        LDMA_TransferCfg_t xferConf = LDMA_TRANSFER_CFG_PERIPHERAL(dma_periph);
-        LDMA_Descriptor_t desc = LDMA_DESCRIPTOR_SINGLE_P2M_BYTE(source_addr, rxdata, rx_length);
-        if(obj->spi.bits >= 9){
-            desc.xfer.size = ldmaCtrlSizeHalf;
-        }
-        LDMAx_StartTransfer(obj->spi.dmaOptionsRX.dmaChannel, &xferConf, &desc, serial_dmaTransferComplete,obj->spi.dmaOptionsRX.dmaCallback.userPtr);
-    }
+    return (end < frames ? end : frames);
 }
 
-#else
 /******************************************
-* void spi_activate_dma(spi_t *obj, void* rxdata, void* txdata, int length)
+* void spi_activate_dma(spi_t *obj)
+*
+* This function will start the DMA engine for SPI transfers. Buffers and
+* lengths are taken from tx_buff and rx_buff, starting at tx_buff.pos.
 *
-* This function will start the DMA engine for SPI transfers
+* As much of the transfer as fits in SPI_DMA_DESCRIPTORS_MAX descriptors is
+* linked into one list per direction, so only the end of the list raises an
+* interrupt. Only the channel finishing last is allowed to interrupt.
 *
-*   * rxdata: pointer to RX buffer, if needed.
-*   * txdata: pointer to TX buffer, if needed. Else FF's.
-*   * tx_length: how many USART frames will be sent.
-*   * rx_length: how many USART frames will be received. If > tx_length, TX will get padded with n lower bits of SPI_FILL_WORD.
+* Frames of 8 bits or less are written two at a time through TXDOUBLE
+* wherever the source is half-word aligned, halving the TX request rate.
+* RX stays one frame per request: RXDATAV is raised for every frame, so a
+* RXDOUBLE read could find only one of the two.
 ******************************************/
-static void spi_activate_dma(spi_t *obj, void* rxdata, const void* txdata, int tx_length, int rx_length)
+#ifdef LDMA_PRESENT
+static void spi_activate_dma(spi_t *obj)
 {
-    /* DMA descriptors */
-    DMA_CfgDescr_TypeDef rxDescrCfg;
-    DMA_CfgDescr_TypeDef txDescrCfg;
+    LDMA_PeripheralSignal_t tx_periph, rx_periph;
+    volatile void *target_addr;
+    volatile void *target_double;
+    volatile const void *source_addr;
+    uint32_t framesize = (obj->spi.bits <= 8 ? 1 : 2);
+    uint32_t end = spi_dma_batch_end(obj);
+    uint32_t pos, count;
+    int i, tx_count;
+
+    /* Select TX target and RX source address. 9 bit frame length requires to use extended register.
+       10 bit and larger frame requires to use TXDOUBLE/RXDOUBLE register. */
+    switch((int)obj->spi.spi) {
+        case USART_0:
+            tx_periph = ldmaPeripheralSignal_USART0_TXBL;
+            rx_periph = ldmaPeripheralSignal_USART0_RXDATAV;
+            target_double = &USART0->TXDOUBLE;
+            if(obj->spi.bits <= 8){
+                target_addr = &USART0->TXDATA;
+                source_addr = &USART0->RXDATA;
+            }else if(obj->spi.bits == 9){
+                target_addr = &USART0->TXDATAX;
+                source_addr = &USART0->RXDATAX;
+            }else{
+                target_addr = &USART0->TXDOUBLE;
+                source_addr = &USART0->RXDOUBLE;
+            }
+            break;
+        case USART_1:
+            tx_periph = ldmaPeripheralSignal_USART1_TXBL;
+            rx_periph = ldmaPeripheralSignal_USART1_RXDATAV;
+            target_double = &USART1->TXDOUBLE;
+            if(obj->spi.bits <= 8){
+                target_addr = &USART1->TXDATA;
+                source_addr = &USART1->RXDATA;
+            }else if(obj->spi.bits == 9){
+                target_addr = &USART1->TXDATAX;
+                source_addr = &USART1->RXDATAX;
+            }else{
+                target_addr = &USART1->TXDOUBLE;
+                source_addr = &USART1->RXDOUBLE;
+            }
+            break;
+        default:
+            EFM_ASSERT(0);
+            while(1);
+            break;
+    }
 
-    /* Split up transfers if the tx length is larger than what the DMA supports. */
-    const int DMA_MAX_TRANSFER = (_DMA_CTRL_N_MINUS_1_MASK >> _DMA_CTRL_N_MINUS_1_SHIFT);
+    /* Build the TX list first. Alignment splits may use up the list before the end of the batch. */
+    for(i = 0, pos = obj->tx_buff.pos; (pos < end) && (i < SPI_DMA_DESCRIPTORS_MAX); i++, pos += count) {
+        /* Past the end of the TX buffer, keep clocking out the fill word */
+        bool fill = (obj->tx_buff.buffer == NULL) || (pos >= obj->tx_buff.length);
+        const uint8_t *src;
+        bool packed;
 
-    if (tx_length > DMA_MAX_TRANSFER) {
-        uint32_t max_length = DMA_MAX_TRANSFER;
+        if(fill) {
+            count = end - pos;
+            src = (const uint8_t *)&fill_word;
+        } else {
+            count = (end < obj->tx_buff.length ? end : obj->tx_buff.length) - pos;
+            src = (const uint8_t *)obj->tx_buff.buffer + pos * framesize;
+        }
 
-        /* Update length for current transfer. */
-        tx_length = max_length;
+        packed = (framesize == 1) && (count >= 2) && (((uint32_t)src & 1) == 0);
+        if(packed) {
+            count &= ~1;
+            if(count > 2 * SPI_DMA_MAX_TRANSFER) {
+                count = 2 * SPI_DMA_MAX_TRANSFER;
+            }
+        } else if(framesize == 1) {
+            /* Single frame to get aligned, or the odd one at the end */
+            count = 1;
+        } else if(count > SPI_DMA_MAX_TRANSFER) {
+            count = SPI_DMA_MAX_TRANSFER;
+        }
+
+        LDMA_Descriptor_t desc = LDMA_DESCRIPTOR_LINKREL_M2P_BYTE(src, packed ? target_double : target_addr, packed ? count / 2 : count, 1);
+        desc.xfer.doneIfs = 0;
+        if(packed || (framesize == 2)){
+            desc.xfer.size = ldmaCtrlSizeHalf;
+        }
+        if(fill) {
+            desc.xfer.srcInc = ldmaCtrlSrcIncNone;
+        }
+        obj->spi.dma_tx_desc[i] = desc;
     }
+    tx_count = i;
+    obj->spi.dma_tx_desc[tx_count - 1].xfer.link = 0;
+    end = pos;
+
+    /* RX has to be armed before the first frame goes out */
+    bool rx_active = (obj->rx_buff.buffer != NULL) && (obj->tx_buff.pos < obj->rx_buff.length);
+    if(rx_active) {
+        uint32_t rx_end = (end < obj->rx_buff.length ? end : obj->rx_buff.length);
+
+        for(i = 0, pos = obj->tx_buff.pos; pos < rx_end; i++, pos += count) {
+            count = rx_end - pos;
+            if(count > SPI_DMA_MAX_TRANSFER) {
+                count = SPI_DMA_MAX_TRANSFER;
+            }
+            LDMA_Descriptor_t desc = LDMA_DESCRIPTOR_LINKREL_P2M_BYTE(source_addr, (uint8_t *)obj->rx_buff.buffer + pos * framesize, count, 1);
+            desc.xfer.doneIfs = 0;
+            if(framesize == 2){
+                desc.xfer.size = ldmaCtrlSizeHalf;
+            }
+            obj->spi.dma_rx_desc[i] = desc;
+        }
+        /* Terminate the list and interrupt on its last descriptor */
+        obj->spi.dma_rx_desc[i - 1].xfer.link = 0;
+        obj->spi.dma_rx_desc[i - 1].xfer.doneIfs = 1;
+
+        /* When RX covers the whole list it finishes last, so TX need not interrupt */
+        rx_active = (rx_end == end);
 
-    /* TODO: allow reception using DMA of over the max transfer size */
-    MBED_ASSERT(rx_length <= DMA_MAX_TRANSFER);
+        LDMA_TransferCfg_t xferConf = LDMA_TRANSFER_CFG_PERIPHERAL(rx_periph);
+        LDMAx_StartTransfer(obj->spi.dmaOptionsRX.dmaChannel, &xferConf, obj->spi.dma_rx_desc, serial_dmaTransferComplete, obj->spi.dmaOptionsRX.dmaCallback.userPtr);
+    }
 
-    /* Save amount of TX done by DMA */
-    obj->tx_buff.pos += tx_length;
+    obj->spi.dma_tx_desc[tx_count - 1].xfer.doneIfs = rx_active ? 0 : 1;
 
-    if(obj->spi.bits != 9) {
-        /* Only activate RX DMA if a receive buffer is specified */
-        if (rxdata != NULL) {
-            // Setting up channel descriptor
-            rxDescrCfg.dstInc = dmaDataInc1;
-            rxDescrCfg.srcInc = dmaDataIncNone;
-            rxDescrCfg.size = dmaDataSize1;
-            rxDescrCfg.arbRate = dmaArbitrate1;
-            rxDescrCfg.hprot = 0;
-            DMA_CfgDescr(obj->spi.dmaOptionsRX.dmaChannel, true, &rxDescrCfg);
+    /* Save amount of frames handed to DMA */
+    obj->tx_buff.pos = end;
 
-            /* Activate RX channel */
-            DMA_ActivateBasic(obj->spi.dmaOptionsRX.dmaChannel, true, false, rxdata, (void *)&(obj->spi.spi->RXDATA),
-                              rx_length - 1);
+    LDMA_TransferCfg_t xferConf = LDMA_TRANSFER_CFG_PERIPHERAL(tx_periph);
+    LDMAx_StartTransfer(obj->spi.dmaOptionsTX.dmaChannel, &xferConf, obj->spi.dma_tx_desc, serial_dmaTransferComplete, obj->spi.dmaOptionsRX.dmaCallback.userPtr);
+}
+
+#else
+static void spi_activate_dma(spi_t *obj)
+{
+    DMA_CfgDescrSGAlt_TypeDef descrCfg;
+    uint32_t framesize = (obj->spi.bits <= 8 ? 1 : 2);
+    uint32_t end = spi_dma_batch_end(obj);
+    uint32_t pos, count;
+    int i, tx_count;
+
+    /* Setting up configuration shared by all descriptors */
+    descrCfg.arbRate = dmaArbitrate1;
+    descrCfg.hprot = 0;
+    descrCfg.peripheral = true;
+
+    /* Build the TX list first. Alignment splits may use up the list before the end of the batch. */
+    descrCfg.dstInc = dmaDataIncNone;
+    for (i = 0, pos = obj->tx_buff.pos; (pos < end) && (i < SPI_DMA_DESCRIPTORS_MAX); i++, pos += count) {
+        /* Past the end of the TX buffer, keep clocking out the static fill word */
+        bool fill = (obj->tx_buff.buffer == NULL) || (pos >= obj->tx_buff.length);
+        bool packed;
+
+        if (fill) {
+            count = end - pos;
+            descrCfg.src = &fill_word;
+        } else {
+            count = (end < obj->tx_buff.length ? end : obj->tx_buff.length) - pos;
+            descrCfg.src = (uint8_t *)obj->tx_buff.buffer + pos * framesize;
         }
 
-        // buffer with all FFs.
-        /* Setting up channel descriptor */
-        txDescrCfg.dstInc = dmaDataIncNone;
-        txDescrCfg.srcInc = (txdata == 0 ? dmaDataIncNone : (obj->spi.bits <= 8 ? dmaDataInc1 : dmaDataInc2)); //Do not increment source pointer when there is no transmit buffer
-        txDescrCfg.size = (obj->spi.bits <= 8 ? dmaDataSize1 : dmaDataSize2); //When frame size > 9, we can use TXDOUBLE to save bandwidth
-        txDescrCfg.arbRate = dmaArbitrate1;
-        txDescrCfg.hprot = 0;
-        DMA_CfgDescr(obj->spi.dmaOptionsTX.dmaChannel, true, &txDescrCfg);
-
-        /* Activate TX channel */
-        DMA_ActivateBasic(  obj->spi.dmaOptionsTX.dmaChannel,
-                            true,
-                            false,
-                            (obj->spi.bits <= 8 ? (void *)&(obj->spi.spi->TXDATA) : (void *)&(obj->spi.spi->TXDOUBLE)), //When frame size > 9, point to TXDOUBLE
-                            (txdata == 0 ? &fill_word : (void *)txdata), // When there is nothing to transmit, point to static fill word
-                            (tx_length - 1));
-    } else {
-        /* Frame size == 9 */
-        /* Only activate RX DMA if a receive buffer is specified */
-        if (rxdata != NULL) {
-            // Setting up channel descriptor
-            rxDescrCfg.dstInc = dmaDataInc2;
-            rxDescrCfg.srcInc = dmaDataIncNone;
-            rxDescrCfg.size = dmaDataSize2;
-            rxDescrCfg.arbRate = dmaArbitrate1;
-            rxDescrCfg.hprot = 0;
-            DMA_CfgDescr(obj->spi.dmaOptionsRX.dmaChannel, true, &rxDescrCfg);
-
-            /* Activate RX channel */
-            DMA_ActivateBasic(obj->spi.dmaOptionsRX.dmaChannel, true, false, rxdata, (void *)&(obj->spi.spi->RXDATAX),
-                              rx_length - 1);
+        packed = (framesize == 1) && (count >= 2) && (((uint32_t)descrCfg.src & 1) == 0);
+        if (packed) {
+            count &= ~1;
+            if (count > 2 * SPI_DMA_MAX_TRANSFER) {
+                count = 2 * SPI_DMA_MAX_TRANSFER;
+            }
+        } else if (framesize == 1) {
+            /* Single frame to get aligned, or the odd one at the end */
+            count = 1;
+        } else if (count > SPI_DMA_MAX_TRANSFER) {
+            count = SPI_DMA_MAX_TRANSFER;
+        }
+
+        if (packed || obj->spi.bits > 9) {
+            /* When frame size > 9, or two 8-bit frames at once, we can use TXDOUBLE to save bandwidth */
+            descrCfg.dst = (void *)&(obj->spi.spi->TXDOUBLE);
+            descrCfg.size = dmaDataSize2;
+        } else {
+            descrCfg.dst = (obj->spi.bits == 9 ? (void *)&(obj->spi.spi->TXDATAX) : (void *)&(obj->spi.spi->TXDATA));
+            descrCfg.size = (framesize == 1 ? dmaDataSize1 : dmaDataSize2);
+        }
+        descrCfg.srcInc = (fill ? dmaDataIncNone : (descrCfg.size == dmaDataSize1 ? dmaDataInc1 : dmaDataInc2));
+        descrCfg.nMinus1 = (packed ? count / 2 : count) - 1;
+        DMA_CfgDescrScatterGather(obj->spi.dma_tx_desc, i, &descrCfg);
+    }
+    tx_count = i;
+    end = pos;
+
+    /* Only activate RX DMA if a receive buffer is specified. RX has to be armed before the first frame goes out. */
+    bool rx_active = (obj->rx_buff.buffer != NULL) && (obj->tx_buff.pos < obj->rx_buff.length);
+    if (rx_active) {
+        uint32_t rx_end = (end < obj->rx_buff.length ? end : obj->rx_buff.length);
+
+        descrCfg.src = (obj->spi.bits <= 8 ? (void *)&(obj->spi.spi->RXDATA) : (obj->spi.bits == 9 ? (void *)&(obj->spi.spi->RXDATAX) : (void *)&(obj->spi.spi->RXDOUBLE)));
+        descrCfg.srcInc = dmaDataIncNone;
+        descrCfg.dstInc = (framesize == 1 ? dmaDataInc1 : dmaDataInc2);
+        descrCfg.size = (framesize == 1 ? dmaDataSize1 : dmaDataSize2);
+
+        for (i = 0, pos = obj->tx_buff.pos; pos < rx_end; i++, pos += count) {
+            count = rx_end - pos;
+            if (count > SPI_DMA_MAX_TRANSFER) {
+                count = SPI_DMA_MAX_TRANSFER;
+            }
+            descrCfg.dst = (uint8_t *)obj->rx_buff.buffer + pos * framesize;
+            descrCfg.nMinus1 = count - 1;
+            DMA_CfgDescrScatterGather(obj->spi.dma_rx_desc, i, &descrCfg);
         }
 
-        /* Setting up channel descriptor */
-        txDescrCfg.dstInc = dmaDataIncNone;
-        txDescrCfg.srcInc = (txdata == 0 ? dmaDataIncNone : dmaDataInc2); //Do not increment source pointer when there is no transmit buffer
-        txDescrCfg.size = dmaDataSize2; //When frame size > 9, we can use TXDOUBLE to save bandwidth
-        txDescrCfg.arbRate = dmaArbitrate1;
-        txDescrCfg.hprot = 0;
-        DMA_CfgDescr(obj->spi.dmaOptionsTX.dmaChannel, true, &txDescrCfg);
+        /* When RX covers the whole list it finishes last, so TX need not interrupt */
+        rx_active = (rx_end == end);
 
-        /* Activate TX channel */
-        DMA_ActivateBasic(  obj->spi.dmaOptionsTX.dmaChannel,
-                            true,
-                            false,
-                            (void *)&(obj->spi.spi->TXDATAX), //When frame size > 9, point to TXDOUBLE
-                            (txdata == 0 ? &fill_word : (void *)txdata), // When there is nothing to transmit, point to static fill word
-                            (tx_length - 1));
+        /* Activate RX channel */
+        DMA_ActivateScatterGather(obj->spi.dmaOptionsRX.dmaChannel, false, obj->spi.dma_rx_desc, i);
     }
+
+    /* Save amount of frames handed to DMA */
+    obj->tx_buff.pos = end;
+
+    /* Drop a completion flag left over from a previous list before (re-)enabling the TX interrupt */
+    DMA->IFC = 1 << obj->spi.dmaOptionsTX.dmaChannel;
+    BUS_RegBitWrite(&(DMA->IEN), obj->spi.dmaOptionsTX.dmaChannel, rx_active ? 0 : 1);
+
+    /* Activate TX channel */
+    DMA_ActivateScatterGather(obj->spi.dmaOptionsTX.dmaChannel, false, obj->spi.dma_tx_desc, tx_count);
 }
 #endif //LDMA_PRESENT
 /********************************************************************
@@ -980,8 +1287,10 @@ void spi_master_transfer_dma(spi_t *obj, const void *txdata, void *rxdata, int t
     obj->spi.spi->CMD = USART_CMD_CLEARRX;
     /* If the DMA channels are already allocated, we can assume they have been setup already */
     if (hint != DMA_USAGE_NEVER && obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_ALLOCATED) {
-        /* setup has already been done, so just activate the transfer */
-        spi_activate_dma(obj, rxdata, txdata, tx_length, rx_length);
+        /* setup has already been done, so just update the handler and activate the transfer */
+        obj->spi.dmaOptionsTX.dmaCallback.userPtr = cb;
+        obj->spi.dmaOptionsRX.dmaCallback.userPtr = cb;
+        spi_activate_dma(obj);
     } else if (hint == DMA_USAGE_NEVER) {
         /* use IRQ */
         obj->spi.spi->IFC = 0xFFFFFFFF;
@@ -1000,7 +1309,7 @@ void spi_master_transfer_dma(spi_t *obj, const void *txdata, void *rxdata, int t
             /* DMA channels are allocated, so do their setup */
             spi_master_dma_channel_setup(obj, cb);
             /* and activate the transfer */
-            spi_activate_dma(obj, rxdata, txdata, tx_length, rx_length);
+            spi_activate_dma(obj);
         } else {
             /* DMA is unavailable, so fall back to IRQ */
             obj->spi.spi->IFC = 0xFFFFFFFF;
@@ -1010,6 +1319,20 @@ void spi_master_transfer_dma(spi_t *obj, const void *txdata, void *rxdata, int t
     }
 }
 
+/* Match the fill word to the frame size of the upcoming transfer */
+static void spi_fill_word_update(spi_t *obj)
+{
+    /* update fill word if on 9-bit frame size */
+    if(obj->spi.bits == 9) {
+        fill_word = SPI_FILL_WORD & 0x1FF;
+    } else if(obj->spi.bits <= 8) {
+        /* Fill frame in both bytes, so it can go out two at a time through TXDOUBLE */
+        fill_word = (SPI_FILL_WORD & 0xFF) * 0x0101;
+    } else {
+        fill_word = (uint16_t)SPI_FILL_WORD;
+    }
+}
+
 /** Begin the SPI transfer. Buffer pointers and lengths are specified in tx_buff and rx_buff
  *
  * @param[in] obj     The SPI object which holds the transfer information
@@ -1025,12 +1348,7 @@ void spi_master_transfer(spi_t *obj, void *tx, size_t tx_length, void *rx, size_
 {
     if( spi_active(obj) ) return;
 
-    /* update fill word if on 9-bit frame size */
-    if(obj->spi.bits == 9) {
-        fill_word = SPI_FILL_WORD & 0x1FF;
-    } else {
-        fill_word = (uint16_t)SPI_FILL_WORD;
-    }
+    spi_fill_word_update(obj);
 
     /* check corner case */
     if(tx_length == 0) {
@@ -1054,45 +1372,34 @@ void spi_master_transfer(spi_t *obj, void *tx, size_t tx_length, void *rx, size_
 
 
 /********************************************************************
-* uint32_t spi_irq_handler_generic(spi_t* obj)
+* static uint32_t spi_irq_handler_transfer(spi_t* obj)
 *
-* handler which should get called by CPP-land when either a DMA or SPI IRQ gets fired for a SPI transaction.
+* Progress the current transfer, either DMA or IRQ driven.
 *
-*   * obj: pointer to the specific SPI instance
-*
-* return: event mask. Currently only 0 or SPI_EVENT_COMPLETE upon transfer completion.
+* return: event mask. Non-zero once the transfer has completed.
 *
 ********************************************************************/
 #ifdef LDMA_PRESENT
-uint32_t spi_irq_handler_asynch(spi_t* obj)
+static uint32_t spi_irq_handler_transfer(spi_t* obj)
 {
     if (obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_ALLOCATED || obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
         /* DMA implementation */
-        /* If there is still data in the TX buffer, setup a new transfer. */
-        if (obj->tx_buff.pos < obj->tx_buff.length) {
-            /* Find position and remaining length without modifying tx_buff. */
-            void* tx_pointer = (char*)obj->tx_buff.buffer + obj->tx_buff.pos;
-            uint32_t tx_length = obj->tx_buff.length - obj->tx_buff.pos;
-
-            /* Begin transfer. Rely on spi_activate_dma to split up the transfer further. */
-            spi_activate_dma(obj, obj->rx_buff.buffer, tx_pointer, tx_length, obj->rx_buff.length);
-
+        /* Wait for both descriptor lists to finish */
+        if (LDMAx_ChannelEnabled(obj->spi.dmaOptionsRX.dmaChannel) || LDMAx_ChannelEnabled(obj->spi.dmaOptionsTX.dmaChannel)) {
             return 0;
         }
-        /* If there is an RX transfer ongoing, wait for it to finish */
-        if (LDMAx_ChannelEnabled(obj->spi.dmaOptionsRX.dmaChannel)) {
-            /* Check if we need to kick off TX transfer again to force more incoming data. */
-            if (LDMA_TransferDone(obj->spi.dmaOptionsTX.dmaChannel) && (obj->tx_buff.pos < obj->rx_buff.length)) {
-                void* tx_pointer = (char*)obj->tx_buff.buffer + obj->tx_buff.pos;
-                uint32_t tx_length = obj->tx_buff.length - obj->tx_buff.pos;
-                /* Begin transfer. Rely on spi_activate_dma to split up the transfer further. */
-                spi_activate_dma(obj, obj->rx_buff.buffer, tx_pointer, tx_length, obj->rx_buff.length);
-            } else return 0;
+        /* If the transfer did not fit in one list, continue with the next part */
+        if (obj->tx_buff.pos < spi_dma_frames(obj)) {
+            spi_activate_dma(obj);
+            return 0;
         }
-        /* If there is still a TX transfer ongoing (tx_length > rx_length), wait for it to finish */
-        if (!LDMA_TransferDone(obj->spi.dmaOptionsTX.dmaChannel)) {
+        /* Transmit has to complete before user code is indicated. Rather than polling, let TXC call back in. */
+        if (!(obj->spi.spi->STATUS & USART_STATUS_TXC)) {
+            spi_enable_txc_interrupt(obj, (uint32_t)obj->spi.dmaOptionsRX.dmaCallback.userPtr, true);
             return 0;
         }
+        spi_enable_txc_interrupt(obj, (uint32_t)NULL, false);
+
         /* Release the dma channels if they were opportunistically allocated */
         if (obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
             dma_channel_free(obj->spi.dmaOptionsTX.dmaChannel);
@@ -1100,8 +1407,6 @@ uint32_t spi_irq_handler_asynch(spi_t* obj)
             obj->spi.dmaOptionsTX.dmaUsageState = DMA_USAGE_OPPORTUNISTIC;
         }
 
-        /* Wait transmit to complete, before user code is indicated*/
-        while(!(obj->spi.spi->STATUS & USART_STATUS_TXC));
         unblockSleepMode(SPI_LEAST_ACTIVE_SLEEPMODE);
         /* return to CPP land to say we're finished */
         return SPI_EVENT_COMPLETE;
@@ -1129,81 +1434,29 @@ uint32_t spi_irq_handler_asynch(spi_t* obj)
     }
 }
 #else
-uint32_t spi_irq_handler_asynch(spi_t* obj)
+static uint32_t spi_irq_handler_transfer(spi_t* obj)
 {
     /* Determine whether the current scenario is DMA or IRQ, and act accordingly */
     if (obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_ALLOCATED || obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
         /* DMA implementation */
 
-        /* If there is still data in the TX buffer, setup a new transfer. */
-        if (obj->tx_buff.pos < obj->tx_buff.length) {
-            /* Find position and remaining length without modifying tx_buff. */
-            void* tx_pointer;
-            if(obj->spi.bits > 8) {
-                tx_pointer = (uint16_t *)obj->tx_buff.buffer + obj->tx_buff.pos;
-            } else {
-                tx_pointer = (uint8_t *)obj->tx_buff.buffer + obj->tx_buff.pos;
-            }
-            uint32_t tx_length = obj->tx_buff.length - obj->tx_buff.pos;
-
-            /* Begin transfer. Rely on spi_activate_dma to split up the transfer further. */
-            spi_activate_dma(obj, obj->rx_buff.buffer, tx_pointer, tx_length, obj->rx_buff.length);
-
+        /* Wait for both descriptor lists to finish */
+        if (DMA_ChannelEnabled(obj->spi.dmaOptionsRX.dmaChannel) || DMA_ChannelEnabled(obj->spi.dmaOptionsTX.dmaChannel)) {
             return 0;
         }
 
-        /* If there is an RX transfer ongoing, wait for it to finish */
-        if (DMA_ChannelEnabled(obj->spi.dmaOptionsRX.dmaChannel)) {
-            /* Check if we need to kick off TX transfer again to force more incoming data. */
-            if (!DMA_ChannelEnabled(obj->spi.dmaOptionsTX.dmaChannel) && (obj->tx_buff.pos < obj->rx_buff.length)) {
-                //Save state of TX transfer amount
-                int length_diff = obj->rx_buff.length - obj->tx_buff.pos;
-                obj->tx_buff.pos = obj->rx_buff.length;
-
-                //Kick off a new DMA transfer
-                DMA_CfgDescr_TypeDef txDescrCfg;
-
-                if(obj->spi.bits != 9) {
-                    fill_word = (uint16_t)SPI_FILL_WORD;
-                    /* Setting up channel descriptor */
-                    txDescrCfg.dstInc = dmaDataIncNone;
-                    txDescrCfg.srcInc = dmaDataIncNone; //Do not increment source pointer when there is no transmit buffer
-                    txDescrCfg.size = (obj->spi.bits <= 8 ? dmaDataSize1 : dmaDataSize2); //When frame size > 9, we can use TXDOUBLE to save bandwidth
-                    txDescrCfg.arbRate = dmaArbitrate1;
-                    txDescrCfg.hprot = 0;
-                    DMA_CfgDescr(obj->spi.dmaOptionsTX.dmaChannel, true, &txDescrCfg);
-
-                    /* Activate TX channel */
-                    DMA_ActivateBasic(  obj->spi.dmaOptionsTX.dmaChannel,
-                                        true,
-                                        false,
-                                        (obj->spi.bits <= 8 ? (void *)&(obj->spi.spi->TXDATA) : (void *)&(obj->spi.spi->TXDOUBLE)), //When frame size > 9, point to TXDOUBLE
-                                        &fill_word, // When there is nothing to transmit, point to static fill word
-                                        (length_diff - 1)); // When using TXDOUBLE, recalculate transfer length
-                } else {
-                    /* Setting up channel descriptor */
-                    fill_word = SPI_FILL_WORD & 0x1FF;
-                    txDescrCfg.dstInc = dmaDataIncNone;
-                    txDescrCfg.srcInc = dmaDataIncNone; //Do not increment source pointer when there is no transmit buffer
-                    txDescrCfg.size = dmaDataSize2; //When frame size > 9, we can use TXDOUBLE to save bandwidth
-                    txDescrCfg.arbRate = dmaArbitrate1;
-                    txDescrCfg.hprot = 0;
-                    DMA_CfgDescr(obj->spi.dmaOptionsTX.dmaChannel, true, &txDescrCfg);
-
-                    DMA_ActivateBasic(  obj->spi.dmaOptionsTX.dmaChannel,
-                                        true,
-                                        false,
-                                        (void *)&(obj->spi.spi->TXDATAX), //When frame size > 9, point to TXDOUBLE
-                                        &fill_word, // When there is nothing to transmit, point to static fill word
-                                        (length_diff - 1));
-                }
-            } else return 0;
+        /* If the transfer did not fit in one list, continue with the next part */
+        if (obj->tx_buff.pos < spi_dma_frames(obj)) {
+            spi_activate_dma(obj);
+            return 0;
         }
 
-        /* If there is still a TX transfer ongoing (tx_length > rx_length), wait for it to finish */
-        if (DMA_ChannelEnabled(obj->spi.dmaOptionsTX.dmaChannel)) {
+        /* Transmit has to complete before user code is indicated. Rather than polling, let TXC call back in. */
+        if (!(obj->spi.spi->STATUS & USART_STATUS_TXC)) {
+            spi_enable_txc_interrupt(obj, (uint32_t)obj->spi.dmaOptionsRX.dmaCallback.userPtr, true);
             return 0;
         }
+        spi_enable_txc_interrupt(obj, (uint32_t)NULL, false);
 
         /* Release the dma channels if they were opportunistically allocated */
         if (obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
@@ -1212,8 +1465,6 @@ uint32_t spi_irq_handler_asynch(spi_t* obj)
             obj->spi.dmaOptionsTX.dmaUsageState = DMA_USAGE_OPPORTUNISTIC;
         }
 
-        /* Wait transmit to complete, before user code is indicated*/
-        while(!(obj->spi.spi->STATUS & USART_STATUS_TXC));
         unblockSleepMode(SPI_LEAST_ACTIVE_SLEEPMODE);
 
         /* return to CPP land to say we're finished */
@@ -1243,14 +1494,411 @@ uint32_t spi_irq_handler_asynch(spi_t* obj)
     }
 }
 #endif // LDMA_PRESENT
+
+/* CTRL fields that differ between devices on one bus */
+#define SPI_DEVICE_CTRL_MASK (_USART_CTRL_CLKPOL_MASK | _USART_CTRL_CLKPHA_MASK | _USART_CTRL_MSBF_MASK)
+
+void spi_device_prepare(spi_device_t *device)
+{
+    MBED_ASSERT(device->bits >= 4 && device->bits <= 16);
+
+    /* Same settings as spi_format() and spi_frequency() would end up with */
+    device->ctrl = (uint32_t)spi_clock_mode(device->mode) | (device->order == SPI_MSB ? USART_CTRL_MSBF : 0);
+    device->frame = (uint32_t)(device->bits - 3) | (uint32_t)usartStopbits1 | (uint32_t)usartNoParity;
+    usart_baud_sync_solve(REFERENCE_FREQUENCY, device->frequency, &(device->clkdiv));
+}
+
+/* Switch the bus over to a prepared device. Only valid while the bus is idle. */
+static void spi_device_apply(spi_t *obj, const spi_device_t *device)
+{
+    obj->spi.spi->CTRL = (obj->spi.spi->CTRL & ~SPI_DEVICE_CTRL_MASK) | device->ctrl;
+    obj->spi.spi->FRAME = device->frame;
+    obj->spi.spi->CLKDIV = device->clkdiv;
+
+    obj->spi.bits = device->bits;
+    obj->spi.msbf = (device->ctrl & USART_CTRL_MSBF) ? 1 : 0;
+}
+
+/* Whether a queued device's chip select is toggled by software, rather than by the USART */
+static inline bool spi_queue_soft_cs(spi_t *obj, const spi_device_t *device)
+{
+    return (device->cs != NC) && (device->cs != obj->spi.cs_pin);
+}
+
+/********************************************************************
+* static void spi_queue_start(spi_t *obj, const spi_transaction_t *transaction)
+*
+* Start a transaction on its device. The bus must be idle.
+*
+********************************************************************/
+static void spi_queue_start(spi_t *obj, const spi_transaction_t *transaction)
+{
+    const spi_device_t *device = transaction->device;
+
+    /* Only reconfigure the bus when switching devices */
+    if (device != obj->spi.queue_device) {
+        if (device->frame != 0) {
+            spi_device_apply(obj, device);
+        } else {
+            spi_format(obj, device->bits, device->mode, (spi_bitorder_t)device->order);
+            spi_frequency(obj, device->frequency);
+        }
+        if (spi_queue_soft_cs(obj, device)) {
+            GPIO_PinModeSet((GPIO_Port_TypeDef)(device->cs >> 4 & 0xF), device->cs & 0xF, gpioModePushPull, 1);
+        }
+        obj->spi.queue_device = device;
+    }
+
+    obj->spi.queue_active = true;
+    if (spi_queue_soft_cs(obj, device)) {
+        GPIO_PinOutClear((GPIO_Port_TypeDef)(device->cs >> 4 & 0xF), device->cs & 0xF);
+    }
+
+    spi_master_transfer(obj, (void *)transaction->tx, transaction->tx_length, transaction->rx, transaction->rx_length,
+                        transaction->handler, transaction->event, transaction->hint);
+}
+
+#if SPI_TRANSACTION_QUEUE_SIZE > 0
+/********************************************************************
+* static void spi_queue_next(spi_t *obj)
+*
+* Start the transaction at the head of the queue. The bus must be idle.
+*
+********************************************************************/
+static void spi_queue_next(spi_t *obj)
+{
+    spi_transaction_t *transaction = &(obj->spi.queue[obj->spi.queue_head]);
+
+    obj->spi.queue_head = (obj->spi.queue_head + 1) % SPI_TRANSACTION_QUEUE_SIZE;
+    obj->spi.queue_count--;
+
+    spi_queue_start(obj, transaction);
+}
+#endif
+
+/********************************************************************
+* static void spi_queue_release(spi_t *obj)
+*
+* Deselect the device of the queued transaction that just ended, if any.
+*
+********************************************************************/
+static void spi_queue_release(spi_t *obj)
+{
+    if (obj->spi.queue_active) {
+        if (spi_queue_soft_cs(obj, obj->spi.queue_device)) {
+            GPIO_PinOutSet((GPIO_Port_TypeDef)(obj->spi.queue_device->cs >> 4 & 0xF), obj->spi.queue_device->cs & 0xF);
+        }
+        obj->spi.queue_active = false;
+    }
+}
+
+int spi_master_transfer_queue(spi_t *obj, const spi_transaction_t *transaction)
+{
+    MBED_ASSERT(transaction != NULL && transaction->device != NULL);
+
+#if SPI_TRANSACTION_QUEUE_SIZE > 0
+    /* The completion interrupt takes transactions off the queue, so keep it out meanwhile */
+    INT_Disable();
+    if (obj->spi.queue_count >= SPI_TRANSACTION_QUEUE_SIZE) {
+        INT_Enable();
+        return SPI_ERROR_QUEUE_FULL;
+    }
+    obj->spi.queue[(obj->spi.queue_head + obj->spi.queue_count) % SPI_TRANSACTION_QUEUE_SIZE] = *transaction;
+    obj->spi.queue_count++;
+
+    /* Kick off right away if the bus is idle, otherwise the running transfer will pick it up */
+    if (!obj->spi.queue_active && !spi_active(obj)) {
+        spi_queue_next(obj);
+    }
+    INT_Enable();
+#else
+    /* No queue, only an idle bus takes a transaction */
+    INT_Disable();
+    if (obj->spi.queue_active || spi_active(obj)) {
+        INT_Enable();
+        return SPI_ERROR_QUEUE_FULL;
+    }
+    spi_queue_start(obj, transaction);
+    INT_Enable();
+#endif
+
+    return 0;
+}
+
+/********************************************************************
+* static uint32_t spi_slave_rx_count(spi_t *obj)
+*
+* Amount of frames stored in the receive buffer by the slave transfer.
+* The RX channel must have been stopped.
+*
+********************************************************************/
+static uint32_t spi_slave_rx_count(spi_t *obj)
+{
+    uint32_t framesize = (obj->spi.bits <= 8 ? 1 : 2);
+    uint32_t count;
+
+    if (obj->rx_buff.buffer == NULL) {
+        return 0;
+    }
+
+#ifdef LDMA_PRESENT
+    /* DST points at the next frame to be stored */
+    count = (LDMA->CH[obj->spi.dmaOptionsRX.dmaChannel].DST - (uint32_t)obj->rx_buff.buffer) / framesize;
+#else
+    /* Each scatter-gather task is copied into the alternate descriptor when started */
+    DMA_DESCRIPTOR_TypeDef *descr = ((DMA_DESCRIPTOR_TypeDef *)(DMA->ALTCTRLBASE)) + obj->spi.dmaOptionsRX.dmaChannel;
+    uint32_t ctrl = descr->CTRL;
+    uint32_t remaining = 0;
+
+    /* Cleared when the transfer was armed, so no task has been loaded yet */
+    if (descr->DSTEND == NULL) {
+        return 0;
+    }
+    /* A descriptor that has run to completion is marked invalid */
+    if (ctrl & _DMA_CTRL_CYCLE_CTRL_MASK) {
+        remaining = ((ctrl & _DMA_CTRL_N_MINUS_1_MASK) >> _DMA_CTRL_N_MINUS_1_SHIFT) + 1;
+    }
+    count = ((uint32_t)descr->DSTEND - (uint32_t)obj->rx_buff.buffer) / framesize + 1 - remaining;
+#endif
+
+    return (count < obj->rx_buff.length ? count : obj->rx_buff.length);
+}
+
+#if DEVICE_INTERRUPTIN
+/********************************************************************
+* static void spi_slave_cs_hook(uint32_t id, gpio_irq_event event)
+*
+* Chip select edge of an armed slave transfer. Only a rising edge after a
+* falling one ends the transfer, so the trailing edge of the transaction
+* the transfer was armed in is ignored. The transfer is torn down from the
+* DMA interrupt, where its completion is handled as well, so the two never
+* run into each other.
+*
+********************************************************************/
+static void spi_slave_cs_hook(uint32_t id, gpio_irq_event event)
+{
+    spi_t *obj = (spi_t *)id;
+
+    if (event == IRQ_FALL) {
+        obj->spi.slave_selected = true;
+    } else if (event == IRQ_RISE && obj->spi.slave_selected) {
+        obj->spi.slave_deselected = true;
+        /* Pend the RX channel, the DMA interrupt then calls the SPI handler */
+#ifdef LDMA_PRESENT
+        LDMA->IFS = 1 << obj->spi.dmaOptionsRX.dmaChannel;
+#else
+        DMA->IFS = 1 << obj->spi.dmaOptionsRX.dmaChannel;
+#endif
+    }
+}
+#endif
+
+/********************************************************************
+* static int spi_slave_arm(spi_t *obj, const void *tx, uint32_t tx_length, void *rx, uint32_t rx_length)
+*
+* Load a slave transfer into DMA, so frames are ready before the master
+* starts clocking. Handler and events are taken from the SPI object.
+*
+* return: 0, or DMA_ERROR_OUT_OF_CHANNELS
+*
+********************************************************************/
+static int spi_slave_arm(spi_t *obj, const void *tx, uint32_t tx_length, void *rx, uint32_t rx_length)
+{
+    MBED_ASSERT(obj->spi.slave_handler != 0);
+
+    /* Init DMA here to include it in the power figure */
+    dma_init();
+    if (obj->spi.dmaOptionsTX.dmaUsageState != DMA_USAGE_ALLOCATED) {
+        spi_enable_dma(obj, DMA_USAGE_OPPORTUNISTIC);
+        if (obj->spi.dmaOptionsTX.dmaUsageState != DMA_USAGE_TEMPORARY_ALLOCATED) {
+            return DMA_ERROR_OUT_OF_CHANNELS;
+        }
+    }
+    spi_master_dma_channel_setup(obj, (void *)obj->spi.slave_handler);
+
+    /* Drop whatever was left over from a transaction the master cut short */
+    obj->spi.spi->CMD = USART_CMD_CLEARTX;
+    obj->spi.spi->CMD = USART_CMD_CLEARRX;
+
+    spi_fill_word_update(obj);
+    if (tx_length == 0) {
+        tx_length = rx_length;
+        tx = NULL;
+    }
+    spi_buffer_set(obj, (void *)tx, tx_length, rx, rx_length);
+
+#ifndef LDMA_PRESENT
+    ((DMA_DESCRIPTOR_TypeDef *)(DMA->ALTCTRLBASE))[obj->spi.dmaOptionsRX.dmaChannel].DSTEND = NULL;
+#endif
+
+    obj->spi.slave_received = 0;
+    obj->spi.slave_selected = false;
+    obj->spi.slave_deselected = false;
+    obj->spi.slave_active = true;
+    blockSleepMode(SPI_LEAST_ACTIVE_SLEEPMODE);
+
+#if DEVICE_INTERRUPTIN
+    gpio_irq_hook(obj->spi.cs_pin, spi_slave_cs_hook, (uint32_t)obj);
+#endif
+    spi_activate_dma(obj);
+
+    return 0;
+}
+
+/********************************************************************
+* static uint32_t spi_slave_irq_handler(spi_t *obj)
+*
+* Progress the armed slave transfer, and arm the staged buffers once it
+* has completed.
+*
+* return: event mask. Non-zero once the transfer has completed.
+*
+********************************************************************/
+static uint32_t spi_slave_irq_handler(spi_t *obj)
+{
+    uint32_t event;
+
+    /* Late interrupt for a transfer that has already ended */
+    if (!obj->spi.slave_active) {
+        return 0;
+    }
+
+    if (obj->spi.slave_deselected) {
+        /* The master ended the transaction early, stop where DMA got to */
+#ifdef LDMA_PRESENT
+        LDMA_StopTransfer(obj->spi.dmaOptionsTX.dmaChannel);
+        LDMA_StopTransfer(obj->spi.dmaOptionsRX.dmaChannel);
+#else
+        DMA_ChannelEnable(obj->spi.dmaOptionsTX.dmaChannel, false);
+        DMA_ChannelEnable(obj->spi.dmaOptionsRX.dmaChannel, false);
+#endif
+        obj->spi.slave_received = spi_slave_rx_count(obj);
+        spi_enable_txc_interrupt(obj, (uint32_t)NULL, false);
+
+        /* Release the dma channels if they were opportunistically allocated */
+        if (obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
+            dma_channel_free(obj->spi.dmaOptionsTX.dmaChannel);
+            dma_channel_free(obj->spi.dmaOptionsRX.dmaChannel);
+            obj->spi.dmaOptionsTX.dmaUsageState = DMA_USAGE_OPPORTUNISTIC;
+        }
+
+        unblockSleepMode(SPI_LEAST_ACTIVE_SLEEPMODE);
+        event = SPI_EVENT_COMPLETE | SPI_EVENT_SLAVE_DESELECT;
+    } else {
+        event = spi_irq_handler_transfer(obj);
+        if (event == 0) {
+            return 0;
+        }
+        obj->spi.slave_received = (obj->rx_buff.buffer != NULL ? obj->rx_buff.length : 0);
+    }
+
+#if DEVICE_INTERRUPTIN
+    gpio_irq_hook(obj->spi.cs_pin, NULL, 0);
+#endif
+    obj->spi.slave_active = false;
+
+    /* Have the staged response in place before the master comes back */
+    if (obj->spi.slave_next_valid) {
+        obj->spi.slave_next_valid = false;
+        if (spi_slave_arm(obj, obj->spi.slave_next_tx, obj->spi.slave_next_tx_length,
+                          obj->spi.slave_next_rx, obj->spi.slave_next_rx_length) != 0) {
+            event |= SPI_EVENT_ERROR;
+        }
+    }
+
+    return event;
+}
+
+int spi_slave_transfer(spi_t *obj, const void *tx, uint32_t tx_length, void *rx, uint32_t rx_length, uint32_t handler, uint32_t event)
+{
+    MBED_ASSERT(!obj->spi.master);
+
+    if (obj->spi.slave_active) {
+        return SPI_ERROR_SLAVE_BUSY;
+    }
+
+    obj->spi.slave_handler = handler;
+    spi_enable_event(obj, SPI_EVENT_ALL, false);
+    spi_enable_event(obj, event, true);
+
+    return spi_slave_arm(obj, tx, tx_length, rx, rx_length);
+}
+
+int spi_slave_transfer_next(spi_t *obj, const void *tx, uint32_t tx_length, void *rx, uint32_t rx_length)
+{
+    int ret = 0;
+
+    MBED_ASSERT(!obj->spi.master);
+
+    /* The completion interrupt consumes the staged buffers, so keep it out meanwhile */
+    INT_Disable();
+    if (obj->spi.slave_next_valid) {
+        ret = SPI_ERROR_SLAVE_BUSY;
+    } else if (obj->spi.slave_active) {
+        obj->spi.slave_next_tx = tx;
+        obj->spi.slave_next_tx_length = tx_length;
+        obj->spi.slave_next_rx = rx;
+        obj->spi.slave_next_rx_length = rx_length;
+        obj->spi.slave_next_valid = true;
+    } else {
+        ret = spi_slave_arm(obj, tx, tx_length, rx, rx_length);
+    }
+    INT_Enable();
+
+    return ret;
+}
+
+uint32_t spi_slave_received(spi_t *obj)
+{
+    return obj->spi.slave_received;
+}
+
+/********************************************************************
+* uint32_t spi_irq_handler_generic(spi_t* obj)
+*
+* handler which should get called by CPP-land when either a DMA or SPI IRQ gets fired for a SPI transaction.
+*
+*   * obj: pointer to the specific SPI instance
+*
+* return: event mask. Currently only 0 or SPI_EVENT_COMPLETE upon transfer completion.
+*
+********************************************************************/
+uint32_t spi_irq_handler_asynch(spi_t* obj)
+{
+    if (!obj->spi.master) {
+        return spi_slave_irq_handler(obj);
+    }
+
+    uint32_t event = spi_irq_handler_transfer(obj);
+
+    if (event & (SPI_EVENT_COMPLETE | SPI_EVENT_INTERNAL_TRANSFER_COMPLETE)) {
+        spi_queue_release(obj);
+
+#if SPI_TRANSACTION_QUEUE_SIZE > 0
+        /* Chain the next transaction straight from the completion interrupt */
+        if (obj->spi.queue_count > 0) {
+            spi_queue_next(obj);
+        }
+#endif
+    }
+
+    return event;
+}
+
 /** Abort an SPI transfer
  *
  * @param obj The SPI peripheral to stop
  */
 void spi_abort_asynch(spi_t *obj)
 {
+    // Drop queued transactions and staged slave buffers, so the completion path won't start them
+#if SPI_TRANSACTION_QUEUE_SIZE > 0
+    obj->spi.queue_count = 0;
+#endif
+    obj->spi.slave_next_valid = false;
+
     // If we're not currently transferring, then there's nothing to do here
-    if(spi_active(obj) != 0) return;
+    if(spi_active(obj) == 0) return;
 
     // Determine whether we're running DMA or interrupt
     if (obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_ALLOCATED || obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
@@ -1262,6 +1910,8 @@ void spi_abort_asynch(spi_t *obj)
         DMA_ChannelEnable(obj->spi.dmaOptionsTX.dmaChannel, false);
         DMA_ChannelEnable(obj->spi.dmaOptionsRX.dmaChannel, false);
 #endif
+        spi_enable_txc_interrupt(obj, (uint32_t)NULL, false);
+
         /* Release the dma channels if they were opportunistically allocated */
         if (obj->spi.dmaOptionsTX.dmaUsageState == DMA_USAGE_TEMPORARY_ALLOCATED) {
             dma_channel_free(obj->spi.dmaOptionsTX.dmaChannel);
@@ -1274,6 +1924,17 @@ void spi_abort_asynch(spi_t *obj)
         spi_enable_interrupt(obj, (uint32_t)NULL, false);
     }
 
+    // Deselect the device of an aborted queued transaction
+    spi_queue_release(obj);
+
+    // Stop watching the chip select of an aborted slave transfer
+    if (obj->spi.slave_active) {
+#if DEVICE_INTERRUPTIN
+        gpio_irq_hook(obj->spi.cs_pin, NULL, 0);
+#endif
+        obj->spi.slave_active = false;
+    }
+
     // Release sleep mode block
     unblockSleepMode(SPI_LEAST_ACTIVE_SLEEPMODE);
 }
@@ -0,0 +1,228 @@
+/***************************************************************************//**
+ * @file spi_nor.c
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "mbed-hal-efm32/device.h"
+#if DEVICE_SPI_ASYNCH
+
+#include <string.h>
+
+#include "mbed-drivers/mbed_assert.h"
+
+#include "mbed-hal-efm32/spi_nor.h"
+#include "mbed-hal-efm32/sleepmodes.h"
+
+#define SPI_NOR_CMD_FAST_READ   0x0B
+
+/* Longest wait for a line, in microseconds. Covers other devices queued ahead on the bus. */
+#define SPI_NOR_TIMEOUT         100000
+
+#define SPI_NOR_LINE_EMPTY      0
+#define SPI_NOR_LINE_FILLING    1
+#define SPI_NOR_LINE_VALID      2
+
+/* The SPI handler is called without arguments, so it has to find the cache on its own */
+static spi_nor_t *spi_nor_active = NULL;
+
+/* Completion of a line read */
+static void spi_nor_irq_handler(void)
+{
+    spi_nor_t *nor = spi_nor_active;
+
+    /* Also starts whatever is queued next on the bus */
+    uint32_t event = spi_irq_handler_asynch(nor->spi);
+
+    if ((event & (SPI_EVENT_COMPLETE | SPI_EVENT_INTERNAL_TRANSFER_COMPLETE)) && (nor->filling >= 0)) {
+        nor->lines[nor->filling].state = SPI_NOR_LINE_VALID;
+        nor->filling = -1;
+    }
+}
+
+/* Sleep until a line has been read from flash, or SPI_NOR_TIMEOUT has passed.
+ * A read that timed out is aborted, together with the rest of the SPI queue. */
+static int spi_nor_wait(spi_nor_t *nor, int index)
+{
+    if (sleep_while(&(nor->lines[index].state), 0xFF, SPI_NOR_LINE_FILLING, SPI_NOR_TIMEOUT) == SPI_NOR_LINE_FILLING) {
+        spi_abort_asynch(nor->spi);
+        nor->lines[index].state = SPI_NOR_LINE_EMPTY;
+        nor->filling = -1;
+        return SPI_NOR_ERROR_TIMEOUT;
+    }
+    return 0;
+}
+
+static int spi_nor_lookup(spi_nor_t *nor, uint32_t addr)
+{
+    int i;
+
+    for (i = 0; i < SPI_NOR_CACHE_LINES; i++) {
+        if ((nor->lines[i].state != SPI_NOR_LINE_EMPTY) && (nor->lines[i].addr == addr)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Least recently used line, empty ones first */
+static int spi_nor_victim(spi_nor_t *nor)
+{
+    int i, victim = 0;
+
+    for (i = 1; i < SPI_NOR_CACHE_LINES; i++) {
+        if (nor->lines[i].stamp < nor->lines[victim].stamp) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+/* Start reading a line from flash. Only one line is read at a time. */
+static int spi_nor_fill(spi_nor_t *nor, int index, uint32_t addr)
+{
+    spi_transaction_t transaction;
+    int ret;
+
+    nor->cmd[0] = SPI_NOR_CMD_FAST_READ;
+    nor->cmd[1] = (addr >> 16) & 0xFF;
+    nor->cmd[2] = (addr >> 8) & 0xFF;
+    nor->cmd[3] = addr & 0xFF;
+    nor->cmd[4] = 0;
+
+    nor->lines[index].addr = addr;
+    nor->lines[index].stamp = 0;
+    nor->lines[index].state = SPI_NOR_LINE_FILLING;
+    nor->filling = index;
+
+    /* Receive over the header too, so the line needs no copy afterwards */
+    transaction.device = &(nor->device);
+    transaction.tx = nor->cmd;
+    transaction.tx_length = SPI_NOR_READ_HEADER;
+    transaction.rx = nor->lines[index].raw;
+    transaction.rx_length = SPI_NOR_READ_HEADER + SPI_NOR_CACHE_LINE_SIZE;
+    transaction.handler = (uint32_t)spi_nor_irq_handler;
+    transaction.event = SPI_EVENT_COMPLETE;
+    /* Hold on to the channels, reads come in bursts */
+    transaction.hint = DMA_USAGE_ALWAYS;
+
+    ret = spi_master_transfer_queue(nor->spi, &transaction);
+    if (ret != 0) {
+        nor->lines[index].state = SPI_NOR_LINE_EMPTY;
+        nor->filling = -1;
+    }
+    return ret;
+}
+
+void spi_nor_init(spi_nor_t *nor, spi_t *spi, PinName cs, int frequency)
+{
+    MBED_ASSERT(spi_nor_active == NULL || spi_nor_active == nor);
+
+    nor->spi = spi;
+    nor->device.cs = cs;
+    nor->device.frequency = frequency;
+    nor->device.bits = 8;
+    nor->device.mode = 0;
+    nor->device.order = SPI_MSB;
+    spi_device_prepare(&(nor->device));
+
+    nor->filling = -1;
+    nor->stamp = 0;
+    nor->hits = 0;
+    nor->misses = 0;
+    nor->prefetches = 0;
+    memset(nor->lines, 0, sizeof(nor->lines));
+
+    spi_nor_active = nor;
+}
+
+int spi_nor_read(spi_nor_t *nor, uint32_t addr, void *buffer, size_t length)
+{
+    uint8_t *dst = (uint8_t *)buffer;
+    int ret;
+
+    while (length > 0) {
+        uint32_t line_addr = addr & ~(uint32_t)(SPI_NOR_CACHE_LINE_SIZE - 1);
+        uint32_t offset = addr - line_addr;
+        size_t chunk = SPI_NOR_CACHE_LINE_SIZE - offset;
+        int index;
+
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        index = spi_nor_lookup(nor, line_addr);
+        if (index >= 0) {
+            nor->hits++;
+        } else {
+            nor->misses++;
+            /* Let a read-ahead finish first, its line may not be the victim */
+            index = nor->filling;
+            if (index >= 0) {
+                ret = spi_nor_wait(nor, index);
+                if (ret != 0) {
+                    return ret;
+                }
+            }
+            index = spi_nor_victim(nor);
+            ret = spi_nor_fill(nor, index, line_addr);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+
+        ret = spi_nor_wait(nor, index);
+        if (ret != 0) {
+            return ret;
+        }
+        memcpy(dst, &(nor->lines[index].raw[SPI_NOR_READ_HEADER + offset]), chunk);
+        nor->lines[index].stamp = ++nor->stamp;
+
+        dst += chunk;
+        addr += chunk;
+        length -= chunk;
+
+        /* Fetch the following line while the caller works on this one */
+        line_addr += SPI_NOR_CACHE_LINE_SIZE;
+        if ((nor->filling < 0) && (spi_nor_lookup(nor, line_addr) < 0)) {
+            if (spi_nor_fill(nor, spi_nor_victim(nor), line_addr) == 0) {
+                nor->prefetches++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+void spi_nor_invalidate(spi_nor_t *nor)
+{
+    int i = nor->filling;
+
+    /* A read that times out is aborted, its line is dropped with the others */
+    if (i >= 0) {
+        (void) spi_nor_wait(nor, i);
+    }
+    for (i = 0; i < SPI_NOR_CACHE_LINES; i++) {
+        nor->lines[i].state = SPI_NOR_LINE_EMPTY;
+        nor->lines[i].stamp = 0;
+    }
+}
+
+#endif
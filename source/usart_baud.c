@@ -0,0 +1,140 @@
+/***************************************************************************//**
+ * @file usart_baud.c
+ *******************************************************************************
+ * @section License
+ * <b>(C) Copyright 2016 Silicon Labs, http://www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "mbed-hal-efm32/device.h"
+#if DEVICE_SERIAL || DEVICE_SPI
+
+#include "mbed-drivers/mbed_assert.h"
+
+#include "mbed-hal-efm32/usart_baud.h"
+
+#include "em_cmu.h"
+
+/* Smallest CLKDIV increment, in 1/256ths. Series 0 has 2 fractional bits
+ * in the divider, Series 1 has 5. */
+#define USART_CLKDIV_STEP   (_USART_CLKDIV_DIV_MASK & (~_USART_CLKDIV_DIV_MASK + 1))
+
+/* Oversampling candidates, in order of preference when errors are equal */
+static const struct {
+    USART_OVS_TypeDef ovs;
+    uint8_t factor;
+} usart_ovs_table[] = {
+    { usartOVS16, 16 },
+    { usartOVS8,   8 },
+    { usartOVS6,   6 },
+    { usartOVS4,   4 },
+};
+
+uint32_t usart_baud_async_solve(uint32_t refFreq, uint32_t baudrate, USART_OVS_TypeDef *ovs, uint32_t *clkdiv)
+{
+    uint32_t best_rate = 0;
+    uint32_t best_error = UINT32_MAX;
+    uint32_t i;
+
+    if (baudrate == 0) return 0;
+
+    if (!refFreq) {
+        refFreq = CMU_ClockFreqGet(cmuClock_HFPER);
+    }
+
+    for (i = 0; i < sizeof(usart_ovs_table) / sizeof(usart_ovs_table[0]); i++) {
+        uint64_t divisor = (uint64_t)usart_ovs_table[i].factor * baudrate;
+        uint64_t div;
+        uint32_t rate, error;
+
+        /* CLKDIV = 256 * (fref / (ovs * br) - 1), rounded to the nearest step */
+        div = (((uint64_t)refFreq << 8) + (divisor / 2)) / divisor;
+        if (div < 256) {
+            /* Would need to divide by less than one */
+            continue;
+        }
+        div -= 256;
+        div = ((div + (USART_CLKDIV_STEP / 2)) / USART_CLKDIV_STEP) * USART_CLKDIV_STEP;
+        if (div > _USART_CLKDIV_DIV_MASK) {
+            /* Too slow to reach, and less oversampling only needs a larger divider */
+            break;
+        }
+
+        rate = (uint32_t)(((uint64_t)refFreq << 8) / ((256 + div) * usart_ovs_table[i].factor));
+        error = (rate > baudrate) ? (rate - baudrate) : (baudrate - rate);
+
+        if (error < best_error) {
+            best_error = error;
+            best_rate = rate;
+            *ovs = usart_ovs_table[i].ovs;
+            *clkdiv = (uint32_t)div;
+        }
+    }
+
+    return best_rate;
+}
+
+uint32_t usart_baud_async_set(USART_TypeDef *usart, uint32_t refFreq, uint32_t baudrate)
+{
+    USART_OVS_TypeDef ovs = usartOVS16;
+    uint32_t clkdiv = 0;
+    uint32_t rate = usart_baud_async_solve(refFreq, baudrate, &ovs, &clkdiv);
+
+    MBED_ASSERT(rate != 0);
+    if (rate == 0) return 0;
+
+    usart->CTRL = (usart->CTRL & ~_USART_CTRL_OVS_MASK) | ovs;
+    usart->CLKDIV = clkdiv;
+
+    return rate;
+}
+
+uint32_t usart_baud_sync_solve(uint32_t refFreq, uint32_t hz, uint32_t *clkdiv)
+{
+    uint32_t div;
+
+    MBED_ASSERT(hz);
+
+    if (!refFreq) {
+        refFreq = CMU_ClockFreqGet(cmuClock_HFPER);
+    }
+
+    /* fSPI = fref / (2 * (1 + CLKDIV / 256)). Fractional bits aren't used in
+     * synchronous mode, so pick the smallest integer divider not exceeding hz. */
+    div = (refFreq + (2 * hz) - 1) / (2 * hz);
+    div = (div > 0) ? (div - 1) : 0;
+    if ((div << 8) > _USART_CLKDIV_DIV_MASK) {
+        div = _USART_CLKDIV_DIV_MASK >> 8;
+    }
+
+    *clkdiv = div << 8;
+
+    return refFreq / (2 * (1 + div));
+}
+
+uint32_t usart_baud_sync_set(USART_TypeDef *usart, uint32_t refFreq, uint32_t hz)
+{
+    uint32_t clkdiv = 0;
+    uint32_t rate = usart_baud_sync_solve(refFreq, hz, &clkdiv);
+
+    usart->CLKDIV = clkdiv;
+
+    return rate;
+}
+
+#endif